@@ -7,8 +7,42 @@
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include <deque>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <charconv>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <type_traits>
 
-// Structure to represent a process
+// Building with -DSCHEDULER_PROFILE adds the counters of --profile to the hot paths. Without it
+// PROFILE() discards its argument, so production builds pay nothing.
+#ifdef SCHEDULER_PROFILE
+#define PROFILE(statement) statement
+#else
+#define PROFILE(statement)
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Structure to represent a process in the tick-based schedulers
 struct Process {
     int id;
     int arrival_time;
@@ -20,556 +54,4989 @@ struct Process {
     Process(int _id, int _arrival_time) : id(_id), arrival_time(_arrival_time), current_burst(0), remaining_time(0), just_from_io(false) {}
 };
 
-// Global variables
-std::vector<Process> processes;
-std::vector<int> cpu_schedule;
-std::vector<int> r_schedule;
-int current_time = 0;
-size_t completed = 0;
-Process* current_cpu_process = nullptr;
-Process* current_io_process = nullptr;
-bool io_exec_flag = true; // Assign to R schedule only if this is true
+// A run of consecutive time units given to the same process (id 0 = idle)
+struct GanttInterval {
+    int id;
+    long long start;
+    long long length;
+};
+
+// Gantt chart stored as runs of the same process instead of one entry per time unit
+struct Timeline {
+    std::vector<GanttInterval> intervals;
 
-// Function to read input file
-void read_input_file(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Error opening input file: " + filename);
+    // Append `length` time units of `id`, extending the last run if it has the same id
+    void append(int id, long long length = 1) {
+        if (!intervals.empty() && intervals.back().id == id) {
+            intervals.back().length += length;
+        } else {
+            intervals.push_back({id, end(), length});
+        }
     }
 
-    int num_processes;
-    if (!(file >> num_processes)) {
-        throw std::runtime_error("Error reading number of processes from file");
+    // Total number of time units on the chart
+    long long end() const {
+        return intervals.empty() ? 0 : intervals.back().start + intervals.back().length;
     }
-    std::cout << "Number of processes: " << num_processes << std::endl;
+};
 
-    // Consume the newline character after reading num_processes
-    file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+enum class OutputFormat { Expanded, Intervals, Binary };
 
-    for (int i = 0; i < num_processes; i++) {
-        std::string line;
-        if (!std::getline(file, line)) {
-            throw std::runtime_error("Error reading line for process " + std::to_string(i+1));
+// Number of device classes a workload may use, see Workload::devices
+const int MAX_DEVICES = 256;
+
+// Gantt chart entries besides processes and idle time (0): time a CPU spends switching to another
+// process and time an R instance spends dispatching one (SimulationConfig::switch_cost and
+// dispatch_latency). Written as `*` and `~` in the text formats.
+const int SWITCH_ID = -1;
+const int DISPATCH_ID = -2;
+
+// Input of a simulation: the processes as read from the input file, never modified by a run.
+// Stored as a structure of arrays with the bursts of all processes in one contiguous arena:
+// process i (ID i + 1) owns bursts[burst_offsets[i]] up to bursts[burst_offsets[i + 1]].
+struct Workload {
+    std::vector<int> arrival_times;
+    std::vector<size_t> burst_offsets = {0};
+    std::vector<int> bursts;  // Alternating CPU and R bursts
+    std::vector<int> weights; // Optional (see read_weights_file), all 1 if empty
+    std::vector<uint8_t> devices;  // Device class of every burst (0 = R, and for CPU bursts), all 0 if empty
+
+    size_t size() const { return arrival_times.size(); }
+    size_t burst_count(size_t process) const { return burst_offsets[process + 1] - burst_offsets[process]; }
+    const int* bursts_of(size_t process) const { return bursts.data() + burst_offsets[process]; }
+    int device_of(size_t process, size_t burst) const { return devices.empty() ? 0 : devices[burst_offsets[process] + burst]; }
+
+    // Tag the last burst pushed onto `bursts` with a device class other than 0
+    void set_last_device(int device) {
+        devices.resize(bursts.size());
+        devices.back() = static_cast<uint8_t>(device);
+    }
+
+    // Append a process whose bursts have already been pushed onto `bursts`
+    void close_process(int arrival_time) {
+        arrival_times.push_back(arrival_time);
+        burst_offsets.push_back(bursts.size());
+        if (!devices.empty()) {
+            devices.resize(bursts.size());
         }
+    }
+};
 
-        std::istringstream iss(line);
-        int arrival_time;
-        if (!(iss >> arrival_time)) {
-            throw std::runtime_error("Error reading arrival time for process " + std::to_string(i+1));
+// How a device class orders the processes waiting for it: first come first served, shortest
+// (remaining) service time first, or round robin with the quantum of the simulation
+enum class DevicePolicy { Fcfs, Sstf, RoundRobin };
+
+struct DeviceConfig {
+    DevicePolicy policy = DevicePolicy::Fcfs;
+    int instances = 1;
+};
+
+// Scheduling algorithm and its parameters
+struct SimulationConfig {
+    int algorithm;              // 1 = FCFS, 2 = RR, 3 = SJF, 4 = SRTN, 5 = MLFQ, 6 = priority with aging, 7 = lottery, 8 = stride
+    int quantum = 2;            // RR, MLFQ (top level), lottery and stride
+    int mlfq_levels = 3;        // MLFQ only
+    long long mlfq_boost = 0;   // MLFQ only: every process returns to the top level this often, 0 = never
+    int aging = 10;             // Priority only: waiting time per priority step, 0 = no aging
+    uint64_t seed = 1;          // Lottery only
+    bool tick_engine = false;   // Use the reference tick-based schedulers
+    bool record_gantt = true;   // Build the Gantt charts (metrics are always collected)
+    int cpus = 1;               // Number of CPUs
+    int resources = 1;          // Number of instances of resource R, of all device classes together
+    std::vector<DeviceConfig> devices;  // Device classes of the non-CPU bursts, class 0 is R; empty = one FCFS class
+    bool per_core_queues = false;  // One ready queue per CPU with work stealing instead of a shared one
+    bool predict_bursts = false;   // SJF and SRTN only: order by predicted instead of actual CPU bursts
+    double alpha = 0.5;            // Weight of the last CPU burst in the prediction of the next one
+    double initial_estimate = 5;   // Prediction of the first CPU burst of every process
+    bool packed_heap = false;      // SJF and SRTN without prediction: PackedShortestFirstQueue
+    std::string checkpoint_file;   // Event engine with the workload in memory: save the state here periodically
+    double checkpoint_interval = 60;  // Seconds between checkpoints
+    bool resume = false;           // Start from the state in checkpoint_file
+    int switch_cost = 0;           // Time units a CPU needs to switch to a different process
+    int dispatch_latency = 0;      // Time units an R instance needs before a process it takes starts its burst
+
+    // The device classes, with the default of one FCFS class of `resources` instances
+    std::vector<DeviceConfig> device_classes() const {
+        if (!devices.empty()) {
+            return devices;
         }
-        
-        Process process(i + 1, arrival_time);
-        std::cout << "Process " << i+1 << " arrival time: " << arrival_time << std::endl;
+        DeviceConfig r;
+        r.instances = resources;
+        return {r};
+    }
 
-        int burst;
-        bool first_burst = true;
-        while (iss >> burst) {
-            process.bursts.push_back(burst);
-            std::cout << "Burst: " << burst << " ";
-            if (first_burst) {
-                process.remaining_time = burst;
-                first_burst = false;
+    // The Gantt chart has SWITCH_ID and DISPATCH_ID entries
+    bool models_overhead() const { return switch_cost > 0 || dispatch_latency > 0; }
+};
+
+// Timing of one process, collected while the simulation runs. Times are -1 until they happen.
+struct ProcessMetrics {
+    int id;
+    int arrival_time;
+    long long service_time;     // Sum of all CPU and R bursts
+    long long first_run = -1;   // First time unit on the CPU
+    long long completion = -1;  // End of the last burst
+
+    long long turnaround() const { return completion - arrival_time; }
+    // Time spent waiting in the CPU and R queues
+    long long waiting() const { return turnaround() - service_time; }
+    long long response() const { return first_run - arrival_time; }
+};
+
+struct Metrics {
+    std::vector<ProcessMetrics> processes;  // Indexed by process ID - 1
+    long long makespan = 0;
+    int cpus = 1;
+    int resources = 1;
+    long long cpu_busy = 0;                 // Summed over all CPUs
+    long long r_busy = 0;                   // Summed over all R instances
+    long long context_switches = 0;         // A CPU changes from one process to a different one
+    long long predicted_bursts = 0;         // CPU bursts completed with a predicted length
+    double prediction_error = 0;            // Sum of |predicted - actual| over those bursts
+    double prediction_bias = 0;             // Sum of predicted - actual over those bursts
+    std::vector<long long> device_busy;     // With device classes: busy time of each, summed over its instances
+    bool overhead = false;                  // Context switch and dispatch costs were modeled
+    long long switch_time = 0;              // Summed over all CPUs
+    long long dispatches = 0;
+    long long dispatch_time = 0;            // Summed over all R instances
+    std::vector<int> device_instances;
+
+    // Fraction of the available CPU (R) time that was used
+    double cpu_utilization() const { return makespan > 0 ? static_cast<double>(cpu_busy) / (makespan * cpus) : 0.0; }
+    double r_utilization() const { return makespan > 0 ? static_cast<double>(r_busy) / (makespan * resources) : 0.0; }
+    double device_utilization(size_t device) const {
+        return makespan > 0 ? static_cast<double>(device_busy[device]) / (makespan * device_instances[device]) : 0.0;
+    }
+    double mean_prediction_error() const { return predicted_bursts > 0 ? prediction_error / predicted_bursts : 0.0; }
+    double mean_prediction_bias() const { return predicted_bursts > 0 ? prediction_bias / predicted_bursts : 0.0; }
+};
+
+#ifdef SCHEDULER_PROFILE
+// Work done by the event engine during one run, see --profile
+struct Profile {
+    long long steps = 0;                // Iterations of the engine loop, one per event time
+    long long ready_queue_pushes = 0;   // Processes entering a ready queue
+    long long ready_queue_pops = 0;     // Processes taken from a ready queue to run
+    long long io_queue_pushes = 0;
+    long long quantum_expirations = 0;
+    long long preemptions = 0;          // Running processes replaced by the ready queue (SRTN, MLFQ)
+    long long steals = 0;               // Per-core queues: processes taken from another CPU's queue
+    long long checkpoints = 0;
+    size_t ready_queue_max = 0;         // Most processes in the ready queues (summed) at one time
+    size_t io_queue_max = 0;            // Most processes waiting for R at one time
+};
+#endif
+
+// Output of a simulation
+struct SimulationResult {
+    std::vector<Timeline> cpu_schedules;  // One per CPU, empty unless SimulationConfig::record_gantt and not streamed
+    std::vector<Timeline> r_schedules;    // One per R instance
+    Metrics metrics;
+#ifdef SCHEDULER_PROFILE
+    Profile profile;
+#endif
+};
+
+// Read-only view of a whole file. Memory-mapped where available, so parsing does not copy it.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const std::string& filename) {
+#ifdef _WIN32
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Error opening input file: " + filename);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Error opening input file: " + filename);
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Error mapping input file: " + filename);
             }
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), size);
         }
-        std::cout << std::endl;
+#endif
+    }
 
-        if (process.bursts.empty()) {
-            throw std::runtime_error("No bursts read for process " + std::to_string(i+1));
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+#ifdef _WIN32
+    std::string buffer;
+#endif
+};
+
+// Whitespace within a line, as skipped by `operator>>`
+inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Parse a decimal int at `pos` after skipping blanks, like `operator>>`: an optional sign
+// followed by digits, stopping at the first non-digit. Returns false (and leaves `pos` alone)
+// if there is no number or it does not fit in an int.
+inline bool parse_int(const char*& pos, const char* end, int& value) {
+    const char* p = pos;
+    while (p < end && is_blank(*p)) {
+        ++p;
+    }
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == end || static_cast<unsigned>(*p - '0') > 9) {
+        return false;
+    }
+    long long result = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') <= 9) {
+        result = result * 10 + (*p - '0');
+        if (result > static_cast<long long>(std::numeric_limits<int>::max()) + 1) {
+            return false;
         }
+        ++p;
+    }
+    result = negative ? -result : result;
+    if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min()) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    pos = p;
+    return true;
+}
 
-        processes.push_back(process);
+// Parse a burst at `pos` like parse_int, with an optional device class tag: `<burst>@<device>`.
+// `device` is 0 without a tag and -1 for a tag that is not a valid device class.
+inline bool parse_burst(const char*& pos, const char* end, int& burst, int& device) {
+    if (!parse_int(pos, end, burst)) {
+        return false;
+    }
+    device = 0;
+    if (pos < end && *pos == '@') {
+        ++pos;
+        if (pos == end || static_cast<unsigned>(*pos - '0') > 9 || !parse_int(pos, end, device) || device >= MAX_DEVICES) {
+            device = -1;
+        }
     }
+    return true;
+}
 
-    std::cout << "Finished reading input file" << std::endl;
-    file.close();
+// ---------------------------------------------------------------------------------------------
+// Binary formats. A binary file starts with an 8-byte header, a 7-byte magic that names its
+// content followed by a version byte, and continues with unsigned LEB128 varints: 7 bits per
+// byte, low bits first, the high bit set on every byte but the last.
+//
+// Workload (version 1): the process count, then for each process the difference between its
+// arrival time and the previous one (zigzag-encoded, so unsorted inputs work), its burst count
+// and its bursts. Version 2, written only for workloads with device classes, follows every R
+// burst with its device class.
+//
+// Gantt chart (version 1): the number of CPUs and of R instances, then every line as in the
+// text formats (CPUs first), each a list of (length, id) records for runs of the same process
+// (id 0 = idle) ended by a zero length. Version 2, written only for charts with context switch
+// and dispatch markers, zigzag-encodes the ids.
+// ---------------------------------------------------------------------------------------------
+
+const size_t BINARY_HEADER_SIZE = 8;
+const char WORKLOAD_MAGIC[] = "SCHEDWL";
+const char GANTT_MAGIC[] = "SCHEDGT";
+const unsigned char BINARY_VERSION = 1;
+const unsigned char BINARY_DEVICES_VERSION = 2;  // Workloads with device classes
+const unsigned char BINARY_MARKERS_VERSION = 2;  // Gantt charts with SWITCH_ID and DISPATCH_ID
+
+// True if `data` starts with the header of `magic`, whatever its version
+inline bool has_magic(const char* data, size_t size, const char* magic) {
+    return size >= BINARY_HEADER_SIZE && std::memcmp(data, magic, BINARY_HEADER_SIZE - 1) == 0;
 }
 
-// Function to write output file
-void write_output_file(const std::string& filename) {
-    std::ofstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Error opening output file");
+// Check the header of a binary file and return the position after it
+inline const char* skip_binary_header(const char* data, size_t size, const char* magic, const std::string& what, unsigned char latest = BINARY_VERSION) {
+    if (!has_magic(data, size, magic)) {
+        throw std::runtime_error("Not a binary " + what);
     }
+    unsigned char version = static_cast<unsigned char>(data[BINARY_HEADER_SIZE - 1]);
+    if (version < BINARY_VERSION || version > latest) {
+        throw std::runtime_error("Unsupported " + what + " version " + std::to_string(static_cast<unsigned char>(data[BINARY_HEADER_SIZE - 1])));
+    }
+    return data + BINARY_HEADER_SIZE;
+}
 
-    for (int cpu : cpu_schedule) {
-        file << (cpu == 0 ? "_ " : std::to_string(cpu) + " ");
+// Encode `value` at `out` and return the end, at most 10 bytes
+inline char* put_varint(char* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(value | 0x80);
+        value >>= 7;
     }
-    file << "\n";
+    *out++ = static_cast<char>(value);
+    return out;
+}
 
-    for (int r : r_schedule) {
-        file << (r == 0 ? "_ " : std::to_string(r) + " ");
+// Decode a varint at `pos`. Returns false (and leaves `pos` alone) if the input ends first or
+// the value does not fit in 64 bits.
+inline bool get_varint(const char*& pos, const char* end, uint64_t& value) {
+    uint64_t result = 0;
+    const char* p = pos;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(*p++);
+        result |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            value = result;
+            pos = p;
+            return true;
+        }
     }
-    file << "\n";
+    return false;
+}
 
-    file.close();
+inline uint64_t zigzag(long long value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
 }
 
-// First-Come, First-Served (FCFS) scheduler
-void fcfs_scheduler() {
-    std::queue<Process*> cpu_queue;
-    std::queue<Process*> io_queue;
-    Process* temp_cpu_process = nullptr;
+inline long long unzigzag(uint64_t value) {
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
 
-    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
-        // Check for newly arrived processes
-        for (auto& process : processes) {
-            if (process.arrival_time == current_time && process.current_burst < process.bursts.size()) {
-                cpu_queue.push(&process);
+// Decode a varint that must lie in [minimum, maximum]
+inline bool get_varint_in(const char*& pos, const char* end, uint64_t minimum, uint64_t maximum, uint64_t& value) {
+    const char* p = pos;
+    if (!get_varint(p, end, value) || value < minimum || value > maximum) {
+        return false;
+    }
+    pos = p;
+    return true;
+}
+
+// Parse a binary workload, see above
+Workload read_binary_workload(const char* data, size_t size, bool verbose) {
+    const char* end = data + size;
+    const char* pos = skip_binary_header(data, size, WORKLOAD_MAGIC, "workload", BINARY_DEVICES_VERSION);
+    bool tagged = static_cast<unsigned char>(data[BINARY_HEADER_SIZE - 1]) == BINARY_DEVICES_VERSION;
+    const uint64_t max_int = static_cast<uint64_t>(std::numeric_limits<int>::max());
+
+    uint64_t num_processes;
+    if (!get_varint_in(pos, end, 0, max_int, num_processes)) {
+        throw std::runtime_error("Error reading number of processes from file");
+    }
+    std::cout << "Number of processes: " << num_processes << std::endl;
+
+    Workload workload;
+    // Every process takes at least 3 bytes, so a corrupt count cannot reserve more than the file
+    size_t count = static_cast<size_t>(std::min<uint64_t>(num_processes, size / 3));
+    workload.arrival_times.reserve(count);
+    workload.burst_offsets.reserve(count + 1);
+    workload.bursts.reserve(size / 2);
+
+    long long arrival_time = 0;
+    for (uint64_t i = 0; i < num_processes; i++) {
+        auto fail = [i](const std::string& message) {
+            throw std::runtime_error(message + " for process " + std::to_string(i + 1));
+        };
+        uint64_t delta;
+        if (!get_varint(pos, end, delta)) {
+            fail("Error reading arrival time");
+        }
+        arrival_time += unzigzag(delta);
+        if (arrival_time < 0) {
+            fail("Negative arrival time");
+        }
+        if (arrival_time > std::numeric_limits<int>::max()) {
+            fail("Error reading arrival time");
+        }
+
+        uint64_t burst_count;
+        if (!get_varint(pos, end, burst_count)) {
+            fail("Error reading line");
+        }
+        if (burst_count == 0) {
+            fail("No bursts read");
+        }
+        size_t first_burst = workload.bursts.size();
+        for (uint64_t b = 0; b < burst_count; b++) {
+            uint64_t burst;
+            if (!get_varint(pos, end, burst)) {
+                fail("Error reading line");
+            }
+            if (burst == 0) {
+                fail("Non-positive burst time");
+            }
+            if (burst > max_int) {
+                fail("Error reading line");
+            }
+            workload.bursts.push_back(static_cast<int>(burst));
+            uint64_t device = 0;
+            if (tagged && b % 2 == 1 && !get_varint_in(pos, end, 0, MAX_DEVICES - 1, device)) {
+                fail("Error reading device");
+            }
+            if (device != 0) {
+                workload.set_last_device(static_cast<int>(device));
             }
         }
+        workload.close_process(static_cast<int>(arrival_time));
 
-        // Check any process remains after conflict in the entrance of the ready queue scenario
-        if (temp_cpu_process != nullptr){
-            cpu_queue.push(temp_cpu_process);
-            temp_cpu_process = nullptr;
+        if (verbose) {
+            std::cout << "Process " << i+1 << " arrival time: " << arrival_time << "\n";
+            for (size_t b = first_burst; b < workload.bursts.size(); b++) {
+                std::cout << "Burst: " << workload.bursts[b] << " ";
+            }
+            std::cout << "\n";
         }
-        // Handle CPU scheduling
-        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
-            current_cpu_process = cpu_queue.front();
-            cpu_queue.pop();
+    }
+
+    std::cout << "Finished reading input file" << std::endl;
+    return workload;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Checkpoints: the state of a running simulation, saved so that an interrupted run can resume
+// with the same output. A checkpoint file has the binary header with the magic `SCHEDCK`
+// followed by varints (zigzag for signed values, the bit pattern for doubles). It only makes
+// sense to the same build with the same configuration and input, which it records and checks.
+// ---------------------------------------------------------------------------------------------
+
+const char CHECKPOINT_MAGIC[] = "SCHEDCK";
+
+class SnapshotWriter {
+public:
+    SnapshotWriter() {
+        data.assign(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + BINARY_HEADER_SIZE - 1);
+        data.push_back(static_cast<char>(BINARY_VERSION));
+    }
+
+    void put(uint64_t value) {
+        char bytes[10];
+        data.insert(data.end(), bytes, put_varint(bytes, value));
+    }
+    void put_signed(long long value) { put(zigzag(value)); }
+    void put_double(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(bits);
+    }
+    void put_string(const std::string& text) {
+        put(text.size());
+        data.insert(data.end(), text.begin(), text.end());
+    }
+
+    // Any sequence container of integers or doubles, preceded by its size
+    template <typename Values>
+    void put_values(const Values& values) {
+        put(values.size());
+        for (const auto& value : values) {
+            put_value(value);
         }
+    }
 
-        if (current_cpu_process != nullptr) {
-            cpu_schedule.push_back(current_cpu_process->id);
-            current_cpu_process->bursts[current_cpu_process->current_burst]--;
+    // Write to `filename` through a temporary file, so a crash while saving leaves the previous
+    // checkpoint intact
+    void save(const std::string& filename) const {
+        std::string temporary = filename + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Error opening checkpoint file: " + temporary);
+        }
+        bool failed = std::fwrite(data.data(), 1, data.size(), file) != data.size();
+        failed = std::fclose(file) != 0 || failed;
+        std::remove(filename.c_str());  // rename() does not replace files on Windows
+        if (failed || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+            throw std::runtime_error("Error writing checkpoint file: " + filename);
+        }
+    }
 
-            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
-                current_cpu_process->current_burst++;
-                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
-                    if (current_io_process == nullptr) {
-                        io_exec_flag = false;
-                    }
-                    io_queue.push(current_cpu_process);
-                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
-                    if (current_io_process == nullptr) {
-                        current_io_process = io_queue.front();
-                        io_queue.pop();
-                    }
-                } else {
-                    completed++;
-                }
-                current_cpu_process = nullptr;
-            }
+private:
+    std::vector<char> data;
+
+    template <typename T>
+    void put_value(T value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            put_double(value);
+        } else if constexpr (std::is_signed<T>::value) {
+            put_signed(value);
         } else {
-            cpu_schedule.push_back(0);
+            put(value);
         }
+    }
+};
 
-        // Handle I/O scheduling
-        if (current_io_process == nullptr && !io_queue.empty()) {
-            current_io_process = io_queue.front();
-            io_queue.pop();
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const std::string& filename) : file(filename), end(file.data + file.size) {
+        pos = skip_binary_header(file.data, file.size, CHECKPOINT_MAGIC, "checkpoint");
+    }
+
+    uint64_t get() {
+        uint64_t value;
+        if (!get_varint(pos, end, value)) {
+            throw std::runtime_error("Truncated checkpoint file");
         }
+        return value;
+    }
+    long long get_signed() { return unzigzag(get()); }
+    double get_double() {
+        uint64_t bits = get();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string get_string() {
+        uint64_t size = get();
+        if (size > static_cast<uint64_t>(end - pos)) {
+            throw std::runtime_error("Truncated checkpoint file");
+        }
+        std::string text(pos, static_cast<size_t>(size));
+        pos += size;
+        return text;
+    }
 
-        if (current_io_process != nullptr && io_exec_flag) {
-            r_schedule.push_back(current_io_process->id);
-            current_io_process->bursts[current_io_process->current_burst]--;
+    // Read what put_values() wrote into a sequence container with push_back()
+    template <typename Values>
+    void get_values(Values& values) {
+        uint64_t size = get();
+        // Every value takes at least one byte
+        if (size > static_cast<uint64_t>(end - pos)) {
+            throw std::runtime_error("Truncated checkpoint file");
+        }
+        values.clear();
+        for (uint64_t i = 0; i < size; i++) {
+            values.push_back(get_value<typename Values::value_type>());
+        }
+    }
 
-            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
-                current_io_process->current_burst++;
-                if (current_io_process->current_burst < current_io_process->bursts.size()) {
-                    // Check if a new process will arrive in the next time unit
-                    bool new_process_next = false;
-                    for (const auto& process : processes) {
-                        if (process.arrival_time == current_time + 1 && process.current_burst < process.bursts.size()) {
-                            new_process_next = true;
-                            break;
-                        }
-                    }
-                    
-                    if (new_process_next) {
-                        temp_cpu_process = current_io_process;
-                    } else {
-                        cpu_queue.push(current_io_process);
-                    }
-                } else {
-                    completed++;
-                }
-                
-                if (!io_queue.empty()) {
-                    current_io_process = io_queue.front();
-                    io_queue.pop();
-                } else {
-                    current_io_process = nullptr;
-                }
-            }
+    // Read a value the checkpoint recorded about its run and check it against this run
+    void expect(uint64_t value, const std::string& what) {
+        if (get() != value) {
+            throw std::runtime_error("The checkpoint was written by a run with a different " + what);
+        }
+    }
+
+private:
+    MappedFile file;
+    const char* pos;
+    const char* end;
+
+    template <typename T>
+    T get_value() {
+        if constexpr (std::is_floating_point<T>::value) {
+            return static_cast<T>(get_double());
+        } else if constexpr (std::is_signed<T>::value) {
+            return static_cast<T>(get_signed());
         } else {
-            r_schedule.push_back(0);
+            return static_cast<T>(get());
         }
+    }
+};
 
-        current_time++;
-        io_exec_flag = true;
+// Function to read input file, text or binary (told apart by the header)
+Workload read_input_file(const std::string& filename, bool verbose = false) {
+    MappedFile file(filename);
+    if (has_magic(file.data, file.size, WORKLOAD_MAGIC)) {
+        return read_binary_workload(file.data, file.size, verbose);
     }
-}
+    const char* pos = file.data;
+    const char* end = file.data + file.size;
 
-// Round Robin (RR) scheduler
-void rr_scheduler(int quantum) {
-    std::deque<Process*> cpu_queue;
-    std::queue<Process*> io_queue;
-    int time_in_quantum = 0;
-    Process* temp_cpu_process = nullptr;
-    std::vector<Process*> new_processes;
+    // The process count may be preceded by empty lines
+    while (pos < end && (is_blank(*pos) || *pos == '\n')) {
+        ++pos;
+    }
+    int num_processes;
+    if (!parse_int(pos, end, num_processes)) {
+        throw std::runtime_error("Error reading number of processes from file");
+    }
+    std::cout << "Number of processes: " << num_processes << std::endl;
 
-    auto compare_rr = [](Process* a, Process* b) {
-        if (a->arrival_time == current_time && b->arrival_time != current_time)
-            return true; // a has higher priority
-        if (b->arrival_time == current_time && a->arrival_time != current_time)
-            return false; // b has higher priority
-        if (a->just_from_io && !b->just_from_io)
-            return true; // a just moved from I/O, higher priority
-        if (b->just_from_io && !a->just_from_io)
-            return false; // b just moved from I/O, higher priority
-        return a->id < b->id; // If all else is equal, choose the process with lower ID
+    Workload workload;
+    workload.arrival_times.reserve(std::max(0, num_processes));
+    workload.burst_offsets.reserve(std::max(0, num_processes) + 1);
+    // Most lines hold a few short bursts; a rough guess saves most of the regrowth
+    workload.bursts.reserve(file.size / 4);
+
+    // Consume the newline character after reading num_processes
+    auto next_line = [&]() {
+        const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        pos = eol == nullptr ? end : eol + 1;
     };
+    next_line();
 
-    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
-        // Check for newly arrived processes
-        for (auto& process : processes) {
-            if (process.arrival_time == current_time && process.current_burst < process.bursts.size()) {
-                new_processes.push_back(&process);
-            }
+    for (int i = 0; i < num_processes; i++) {
+        if (pos >= end) {
+            throw std::runtime_error("Error reading line for process " + std::to_string(i+1));
         }
+        const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* line_end = eol == nullptr ? end : eol;
 
-        // Sort new processes according to priority
-        std::sort(new_processes.begin(), new_processes.end(), compare_rr);
+        int arrival_time;
+        if (!parse_int(pos, line_end, arrival_time)) {
+            throw std::runtime_error("Error reading arrival time for process " + std::to_string(i+1));
+        }
 
-        // Add sorted new processes to the end of the queue
-        for (auto* process : new_processes) {
-            cpu_queue.push_back(process);
+        if (arrival_time < 0) {
+            throw std::runtime_error("Negative arrival time for process " + std::to_string(i+1));
         }
-        new_processes.clear();
 
-        // Handle CPU scheduling
-        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
-            current_cpu_process = cpu_queue.front();
-            cpu_queue.pop_front();
-            time_in_quantum = 0;
-            current_cpu_process->just_from_io = false; // Reset the flag when process starts CPU burst
+        // Bursts end at the first token that is not a number, like `while (iss >> burst)`.
+        // They go straight into the arena.
+        size_t first_burst = workload.bursts.size();
+        int burst;
+        int device;
+        while (parse_burst(pos, line_end, burst, device)) {
+            if (burst <= 0) {
+                throw std::runtime_error("Non-positive burst time for process " + std::to_string(i+1));
+            }
+            workload.bursts.push_back(burst);
+            if (device < 0) {
+                throw std::runtime_error("Invalid device for process " + std::to_string(i+1));
+            }
+            if (device != 0 && (workload.bursts.size() - first_burst) % 2 == 1) {
+                throw std::runtime_error("Device on a CPU burst of process " + std::to_string(i+1));
+            }
+            if (device != 0) {
+                workload.set_last_device(device);
+            }
         }
 
-        if (current_cpu_process != nullptr) {
-            cpu_schedule.push_back(current_cpu_process->id);
-            current_cpu_process->bursts[current_cpu_process->current_burst]--;
-            time_in_quantum++;
+        if (workload.bursts.size() == first_burst) {
+            throw std::runtime_error("No bursts read for process " + std::to_string(i+1));
+        }
 
-            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
-                current_cpu_process->current_burst++;
-                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
-                    if (current_io_process == nullptr) {
-                        io_exec_flag = false;
-                    }
-                    io_queue.push(current_cpu_process);
+        workload.close_process(arrival_time);
+
+        if (verbose) {
+            std::cout << "Process " << i+1 << " arrival time: " << arrival_time << "\n";
+            for (size_t b = first_burst; b < workload.bursts.size(); b++) {
+                std::cout << "Burst: " << workload.bursts[b] << " ";
+            }
+            std::cout << "\n";
+        }
+
+        pos = eol == nullptr ? end : eol + 1;
+    }
+
+    std::cout << "Finished reading input file" << std::endl;
+    return workload;
+}
+
+// Read the weight of every process (its priority for priority scheduling, its tickets for
+// lottery and stride scheduling): positive integers in process order, separated by whitespace
+void read_weights_file(const std::string& filename, Workload& workload) {
+    MappedFile file(filename);
+    const char* pos = file.data;
+    const char* end = file.data + file.size;
+
+    workload.weights.clear();
+    workload.weights.reserve(workload.size());
+    for (size_t i = 0; i < workload.size(); i++) {
+        while (pos < end && (is_blank(*pos) || *pos == '\n')) {
+            ++pos;
+        }
+        int weight;
+        if (!parse_int(pos, end, weight)) {
+            throw std::runtime_error("Error reading weight for process " + std::to_string(i+1));
+        }
+        if (weight <= 0) {
+            throw std::runtime_error("Non-positive weight for process " + std::to_string(i+1));
+        }
+        workload.weights.push_back(weight);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Synthetic workloads: seeded random inputs of any size, for benchmarking and testing
+// ---------------------------------------------------------------------------------------------
+
+// Random distribution of a time with a given mean
+struct Distribution {
+    enum Kind { Constant, Uniform, Exponential };
+    Kind kind = Exponential;
+    double mean = 5;
+
+    // A value of at least `minimum` (clamped to the int range)
+    int sample(std::mt19937_64& rng, int minimum) const {
+        double value = mean;
+        if (kind == Uniform) {
+            value = std::uniform_real_distribution<double>(minimum, 2 * mean - minimum)(rng);
+        } else if (kind == Exponential) {
+            value = minimum + std::exponential_distribution<double>(1.0 / std::max(mean - minimum, 1e-9))(rng);
+        }
+        value = std::min(std::floor(value), static_cast<double>(std::numeric_limits<int>::max()));
+        return std::max(minimum, static_cast<int>(value));
+    }
+};
+
+// Parse a distribution written as `<kind>:<mean>`, e.g. "exponential:8" or "uniform:3"
+Distribution parse_distribution(const std::string& text) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("Expected <kind>:<mean>, got " + text);
+    }
+    Distribution distribution;
+    std::string kind = text.substr(0, colon);
+    if (kind == "constant") {
+        distribution.kind = Distribution::Constant;
+    } else if (kind == "uniform") {
+        distribution.kind = Distribution::Uniform;
+    } else if (kind == "exponential") {
+        distribution.kind = Distribution::Exponential;
+    } else {
+        throw std::invalid_argument("Unknown distribution: " + kind);
+    }
+    distribution.mean = std::stod(text.substr(colon + 1));
+    if (!(distribution.mean >= 0)) {
+        throw std::invalid_argument("Negative mean in " + text);
+    }
+    return distribution;
+}
+
+struct GeneratorConfig {
+    size_t processes = 1000;
+    uint64_t seed = 1;
+    Distribution arrival_gap{Distribution::Exponential, 4};  // Time between consecutive arrivals
+    Distribution cpu_burst{Distribution::Exponential, 6};
+    Distribution r_burst{Distribution::Exponential, 4};
+    int min_pairs = 1;  // CPU/R burst pairs per process, uniform in [min_pairs, max_pairs]
+    int max_pairs = 3;
+};
+
+// Generate a workload in arrival order. Every process has its CPU/R burst pairs followed by a
+// final CPU burst. The same configuration always produces the same workload.
+Workload generate_workload(const GeneratorConfig& config) {
+    if (config.min_pairs < 0 || config.max_pairs < config.min_pairs) {
+        throw std::invalid_argument("Invalid number of burst pairs");
+    }
+    std::mt19937_64 rng(config.seed);
+    std::uniform_int_distribution<int> pairs(config.min_pairs, config.max_pairs);
+
+    Workload workload;
+    workload.arrival_times.reserve(config.processes);
+    workload.burst_offsets.reserve(config.processes + 1);
+    workload.bursts.reserve(config.processes * (config.min_pairs + config.max_pairs + 1));
+    long long arrival_time = 0;
+    for (size_t i = 0; i < config.processes; i++) {
+        if (i > 0) {
+            arrival_time = std::min<long long>(arrival_time + config.arrival_gap.sample(rng, 0), std::numeric_limits<int>::max());
+        }
+        for (int p = pairs(rng); p > 0; p--) {
+            workload.bursts.push_back(config.cpu_burst.sample(rng, 1));
+            workload.bursts.push_back(config.r_burst.sample(rng, 1));
+        }
+        workload.bursts.push_back(config.cpu_burst.sample(rng, 1));
+        workload.close_process(static_cast<int>(arrival_time));
+    }
+    return workload;
+}
+
+// Write `workload` in the input file format
+void write_input_file(const std::string& filename, const Workload& workload) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Error opening workload file: " + filename);
+    }
+    std::vector<char> buffer(1 << 20);
+    char* pos = buffer.data();
+    char* end = buffer.data() + buffer.size();
+    // Room for one number and its separator
+    const size_t max_number = 12;
+    auto put = [&](long long value, char separator) {
+        if (static_cast<size_t>(end - pos) < max_number) {
+            std::fwrite(buffer.data(), 1, pos - buffer.data(), file);
+            pos = buffer.data();
+        }
+        pos = std::to_chars(pos, pos + max_number - 1, value).ptr;
+        *pos++ = separator;
+    };
+
+    put(static_cast<long long>(workload.size()), '\n');
+    for (size_t i = 0; i < workload.size(); i++) {
+        put(workload.arrival_times[i], ' ');
+        const int* bursts = workload.bursts_of(i);
+        for (size_t b = 0; b < workload.burst_count(i); b++) {
+            char separator = b + 1 < workload.burst_count(i) ? ' ' : '\n';
+            int device = workload.device_of(i, b);
+            if (device == 0) {
+                put(bursts[b], separator);
+            } else {
+                put(bursts[b], '@');
+                put(device, separator);
+            }
+        }
+    }
+    std::fwrite(buffer.data(), 1, pos - buffer.data(), file);
+    bool failed = std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    if (failed) {
+        throw std::runtime_error("Error writing workload file: " + filename);
+    }
+}
+
+// Write `workload` in the binary workload format
+void write_binary_input_file(const std::string& filename, const Workload& workload) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Error opening workload file: " + filename);
+    }
+    std::vector<char> buffer(1 << 20);
+    char* pos = buffer.data();
+    char* end = buffer.data() + buffer.size();
+    const size_t max_varint = 10;
+    auto put = [&](uint64_t value) {
+        if (static_cast<size_t>(end - pos) < max_varint) {
+            std::fwrite(buffer.data(), 1, pos - buffer.data(), file);
+            pos = buffer.data();
+        }
+        pos = put_varint(pos, value);
+    };
+
+    std::memcpy(pos, WORKLOAD_MAGIC, BINARY_HEADER_SIZE - 1);
+    bool tagged = !workload.devices.empty();
+    pos[BINARY_HEADER_SIZE - 1] = static_cast<char>(tagged ? BINARY_DEVICES_VERSION : BINARY_VERSION);
+    pos += BINARY_HEADER_SIZE;
+    put(workload.size());
+    long long previous_arrival = 0;
+    for (size_t i = 0; i < workload.size(); i++) {
+        put(zigzag(workload.arrival_times[i] - previous_arrival));
+        previous_arrival = workload.arrival_times[i];
+        const int* bursts = workload.bursts_of(i);
+        put(workload.burst_count(i));
+        for (size_t b = 0; b < workload.burst_count(i); b++) {
+            put(static_cast<uint64_t>(bursts[b]));
+            if (tagged && b % 2 == 1) {
+                put(static_cast<uint64_t>(workload.device_of(i, b)));
+            }
+        }
+    }
+    std::fwrite(buffer.data(), 1, pos - buffer.data(), file);
+    bool failed = std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    if (failed) {
+        throw std::runtime_error("Error writing workload file: " + filename);
+    }
+}
+
+// Buffered writer for one Gantt chart line. Runs of the same process are merged as they are
+// appended and formatted straight into a large reusable buffer, which is written out in blocks,
+// so writing costs no allocation per time slot.
+class GanttLineWriter {
+public:
+    GanttLineWriter(std::FILE* file, OutputFormat format, bool markers = false) : file(file), format(format), markers(markers) {}
+
+    // Append `length` time units of `id` (0 = idle)
+    void append(int id, long long length = 1) {
+        if (length <= 0) {
+            return;
+        }
+        if (open_length > 0 && id == open_id) {
+            open_length += length;
+            return;
+        }
+        write_run();
+        open_id = id;
+        open_start += open_length;
+        open_length = length;
+    }
+
+    // Write the last run and the end of the line
+    void finish() {
+        write_run();
+        open_start += open_length;
+        open_length = 0;
+        if (format == OutputFormat::Binary) {
+            write_bytes("", 1);  // Zero length
+        } else {
+            write_bytes("\n", 1);
+        }
+        flush();
+    }
+
+    void flush() {
+        PROFILE(auto start = std::chrono::steady_clock::now());
+        if (used > 0 && std::fwrite(buffer.data(), 1, used, file) != used) {
+            throw std::runtime_error("Error writing output file");
+        }
+        used = 0;
+        PROFILE(write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+#ifdef SCHEDULER_PROFILE
+    double write_seconds = 0;  // Time spent in flush()
+#endif
+
+    // The run that is still open, which has not been written yet
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_signed(open_id);
+        snapshot.put_signed(open_start);
+        snapshot.put_signed(open_length);
+    }
+    void restore(SnapshotReader& snapshot) {
+        used = 0;
+        open_id = static_cast<int>(snapshot.get_signed());
+        open_start = snapshot.get_signed();
+        open_length = snapshot.get_signed();
+    }
+
+private:
+    std::FILE* file;
+    OutputFormat format;
+    bool markers;  // Binary version 2
+    std::vector<char> buffer;
+    size_t used = 0;
+    int open_id = 0;
+    long long open_start = 0;
+    long long open_length = 0;
+
+    // The buffer starts small and grows up to BUFFER_LIMIT before it is flushed, so that a chart
+    // with thousands of short lines does not hold the full size for each of them
+    static const size_t BUFFER_LIMIT = 1 << 20;
+
+    // Make room for at least `count` bytes (at most a token) after `used`
+    void make_room(size_t count) {
+        if (buffer.size() - used >= count) {
+            return;
+        }
+        if (buffer.size() < BUFFER_LIMIT) {
+            buffer.resize(std::max<size_t>(buffer.size() * 2, 4096));
+        } else {
+            flush();
+        }
+    }
+
+    void write_bytes(const char* bytes, size_t count) {
+        make_room(count);
+        std::memcpy(buffer.data() + used, bytes, count);
+        used += count;
+    }
+
+    // `id` followed by `separator`, `_` for idle. Returns the number of characters.
+    static size_t format_id(char* out, int id, char separator) {
+        char* end = out;
+        if (id == 0) {
+            *end++ = '_';
+        } else if (id == SWITCH_ID) {
+            *end++ = '*';
+        } else if (id == DISPATCH_ID) {
+            *end++ = '~';
+        } else {
+            end = std::to_chars(out, out + 16, id).ptr;
+        }
+        *end++ = separator;
+        return static_cast<size_t>(end - out);
+    }
+
+    void write_run() {
+        if (open_length <= 0) {
+            return;
+        }
+        char token[64];
+        if (format == OutputFormat::Binary) {
+            char* end = put_varint(token, static_cast<uint64_t>(open_length));
+            end = put_varint(end, markers ? zigzag(open_id) : static_cast<uint64_t>(open_id));
+            write_bytes(token, static_cast<size_t>(end - token));
+            return;
+        }
+        if (format == OutputFormat::Intervals) {
+            // A long long has at most 20 characters, so the token cannot overflow
+            char* end = token + format_id(token, open_id, ',');
+            end = std::to_chars(end, end + 20, open_start).ptr;
+            *end++ = ',';
+            end = std::to_chars(end, end + 20, open_length).ptr;
+            *end++ = ' ';
+            write_bytes(token, static_cast<size_t>(end - token));
+            return;
+        }
+
+        // One token per time unit: copy the token once, then double the copied block
+        size_t token_length = format_id(token, open_id, ' ');
+        long long remaining = open_length;
+        while (remaining > 0) {
+            make_room(token_length);
+            long long fit = static_cast<long long>((buffer.size() - used) / token_length);
+            size_t count = static_cast<size_t>(std::min(remaining, fit));
+            char* out = buffer.data() + used;
+            std::memcpy(out, token, token_length);
+            size_t filled = token_length;
+            size_t total = count * token_length;
+            while (filled < total) {
+                size_t chunk = std::min(filled, total - filled);
+                std::memcpy(out + filled, out, chunk);
+                filled += chunk;
+            }
+            used += total;
+            remaining -= static_cast<long long>(count);
+        }
+    }
+};
+
+// Writes the output file while the simulation produces it: one line per CPU followed by one line
+// per R instance. The first line goes straight to the file; the others are spooled to temporary
+// files and appended by finish(), so no line has to be held in memory.
+//
+// A `resumable` writer spools to files named after the output file (`out.txt.1`, ...) that a
+// checkpoint can refer to, and with `resume` it reopens the files of an interrupted run, which
+// restore() then cuts back to the checkpoint.
+class GanttWriter {
+public:
+    // With `markers` the chart may hold SWITCH_ID and DISPATCH_ID
+    GanttWriter(const std::string& filename, OutputFormat format, size_t cpus = 1, size_t resources = 1, bool resumable = false, bool resume = false, bool markers = false)
+        : format(format), cpus(cpus) {
+        const char* mode = resume ? "r+b" : resumable ? "w+b" : "wb";
+        files.push_back(std::fopen(filename.c_str(), mode));
+        for (size_t line = 1; line < cpus + resources && files.back() != nullptr; line++) {
+            if (resumable) {
+                spool_names.push_back(filename + "." + std::to_string(line));
+                files.push_back(std::fopen(spool_names.back().c_str(), mode));
+            } else {
+                files.push_back(std::tmpfile());
+            }
+        }
+        if (files.back() == nullptr) {
+            close();
+            throw std::runtime_error("Error opening output file");
+        }
+        for (std::FILE* file : files) {
+            lines.emplace_back(file, format, markers);
+        }
+        if (format == OutputFormat::Binary && !resume) {
+            char header[BINARY_HEADER_SIZE + 20];
+            std::memcpy(header, GANTT_MAGIC, BINARY_HEADER_SIZE - 1);
+            header[BINARY_HEADER_SIZE - 1] = static_cast<char>(markers ? BINARY_MARKERS_VERSION : BINARY_VERSION);
+            char* end = put_varint(header + BINARY_HEADER_SIZE, cpus);
+            end = put_varint(end, resources);
+            if (std::fwrite(header, 1, end - header, files.front()) != static_cast<size_t>(end - header)) {
+                close();
+                throw std::runtime_error("Error writing output file");
+            }
+        }
+    }
+
+    ~GanttWriter() { close(); }
+
+    GanttWriter(const GanttWriter&) = delete;
+    GanttWriter& operator=(const GanttWriter&) = delete;
+
+    void append_cpu(size_t cpu, int id, long long length) { lines[cpu].append(id, length); }
+    void append_r(size_t resource, int id, long long length) { lines[cpus + resource].append(id, length); }
+
+#ifdef SCHEDULER_PROFILE
+    // Time spent writing the lines so far, which happens while the simulation runs
+    double write_seconds() const {
+        double seconds = 0;
+        for (const auto& line : lines) {
+            seconds += line.write_seconds;
+        }
+        return seconds;
+    }
+#endif
+
+    void finish() {
+        for (auto& line : lines) {
+            line.finish();
+        }
+        std::FILE* file = files.front();
+        char block[1 << 16];
+        for (size_t spool = 1; spool < files.size(); spool++) {
+            std::rewind(files[spool]);
+            size_t count;
+            while ((count = std::fread(block, 1, sizeof(block), files[spool])) > 0) {
+                if (std::fwrite(block, 1, count, file) != count) {
+                    throw std::runtime_error("Error writing output file");
+                }
+            }
+        }
+        if (std::fflush(file) != 0) {
+            throw std::runtime_error("Error writing output file");
+        }
+        close();
+        for (const auto& name : spool_names) {
+            std::remove(name.c_str());
+        }
+    }
+
+    // Write out everything appended so far and record where every file ends
+    void save(SnapshotWriter& snapshot) {
+        snapshot.put(static_cast<uint64_t>(format));
+        snapshot.put(files.size());
+        for (size_t line = 0; line < files.size(); line++) {
+            lines[line].flush();
+            if (std::fflush(files[line]) != 0) {
+                throw std::runtime_error("Error writing output file");
+            }
+            snapshot.put(static_cast<uint64_t>(file_size(files[line])));
+            lines[line].save(snapshot);
+        }
+    }
+
+    // Drop whatever was written after the checkpoint and continue from there
+    void restore(SnapshotReader& snapshot) {
+        snapshot.expect(static_cast<uint64_t>(format), "output format");
+        snapshot.expect(files.size(), "number of CPUs and R instances");
+        for (size_t line = 0; line < files.size(); line++) {
+            uint64_t size = snapshot.get();
+            if (std::fflush(files[line]) != 0 || static_cast<uint64_t>(file_size(files[line])) < size || !truncate_file(files[line], size)) {
+                throw std::runtime_error("The output files do not match the checkpoint");
+            }
+            lines[line].restore(snapshot);
+        }
+    }
+
+private:
+    OutputFormat format;
+    size_t cpus;
+    std::vector<std::FILE*> files;  // The output file, then one spool per further line
+    std::vector<std::string> spool_names;  // Resumable writers only
+    std::vector<GanttLineWriter> lines;
+
+    void close() {
+        for (std::FILE* file : files) {
+            if (file != nullptr) {
+                std::fclose(file);
+            }
+        }
+        files.clear();
+    }
+
+    // Never negative, an error throws
+    static long long file_size(std::FILE* file) {
+        if (std::fseek(file, 0, SEEK_END) != 0) {
+            throw std::runtime_error("Error seeking in output file");
+        }
+#ifdef _WIN32
+        long long size = _ftelli64(file);
+#else
+        long long size = ftello(file);
+#endif
+        if (size < 0) {
+            throw std::runtime_error("Error seeking in output file");
+        }
+        return size;
+    }
+
+    // Cut `file` to `size` bytes and continue writing at its end
+    static bool truncate_file(std::FILE* file, uint64_t size) {
+#ifdef _WIN32
+        bool truncated = _chsize_s(_fileno(file), static_cast<long long>(size)) == 0;
+#else
+        bool truncated = ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+        return truncated && std::fseek(file, 0, SEEK_END) == 0;
+    }
+};
+
+// Function to write output file
+void write_output_file(const std::string& filename, const SimulationResult& result, OutputFormat format = OutputFormat::Expanded) {
+    bool markers = false;
+    for (const auto* schedules : {&result.cpu_schedules, &result.r_schedules}) {
+        for (const Timeline& timeline : *schedules) {
+            for (const auto& interval : timeline.intervals) {
+                markers = markers || interval.id < 0;
+            }
+        }
+    }
+    GanttWriter writer(filename, format, result.cpu_schedules.size(), result.r_schedules.size(), false, false, markers);
+    for (size_t cpu = 0; cpu < result.cpu_schedules.size(); cpu++) {
+        for (const auto& interval : result.cpu_schedules[cpu].intervals) {
+            writer.append_cpu(cpu, interval.id, interval.length);
+        }
+    }
+    for (size_t resource = 0; resource < result.r_schedules.size(); resource++) {
+        for (const auto& interval : result.r_schedules[resource].intervals) {
+            writer.append_r(resource, interval.id, interval.length);
+        }
+    }
+    writer.finish();
+}
+
+// Read a Gantt chart written in any output format. Text files do not record how many of their
+// lines are CPUs, so the first `cpus` lines are taken as CPUs and the rest as R instances.
+SimulationResult read_output_file(const std::string& filename, size_t cpus = 1) {
+    MappedFile file(filename);
+    const char* end = file.data + file.size;
+    SimulationResult result;
+
+    if (has_magic(file.data, file.size, GANTT_MAGIC)) {
+        const char* pos = skip_binary_header(file.data, file.size, GANTT_MAGIC, "Gantt chart", BINARY_MARKERS_VERSION);
+        bool markers = static_cast<unsigned char>(file.data[BINARY_HEADER_SIZE - 1]) == BINARY_MARKERS_VERSION;
+        uint64_t cpu_count, resource_count;
+        if (!get_varint_in(pos, end, 0, file.size, cpu_count) || !get_varint_in(pos, end, 0, file.size, resource_count)) {
+            throw std::runtime_error("Error reading the number of Gantt chart lines");
+        }
+        result.cpu_schedules.resize(cpu_count);
+        result.r_schedules.resize(resource_count);
+        for (size_t line = 0; line < cpu_count + resource_count; line++) {
+            Timeline& timeline = line < cpu_count ? result.cpu_schedules[line] : result.r_schedules[line - cpu_count];
+            uint64_t length, id;
+            while (true) {
+                if (!get_varint(pos, end, length)) {
+                    throw std::runtime_error("Error reading Gantt chart line " + std::to_string(line + 1));
+                }
+                if (length == 0) {
+                    break;
+                }
+                if (!get_varint(pos, end, id)) {
+                    throw std::runtime_error("Error reading Gantt chart line " + std::to_string(line + 1));
+                }
+                const uint64_t past_int = static_cast<uint64_t>(std::numeric_limits<int>::max()) + 1;
+                long long value = markers ? unzigzag(id) : static_cast<long long>(std::min(id, past_int));
+                if (value < DISPATCH_ID || value > std::numeric_limits<int>::max()) {
+                    throw std::runtime_error("Error reading Gantt chart line " + std::to_string(line + 1));
+                }
+                timeline.append(static_cast<int>(value), static_cast<long long>(length));
+            }
+        }
+        return result;
+    }
+
+    std::vector<Timeline> lines;
+    for (const char* pos = file.data; pos < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* line_end = eol == nullptr ? end : eol;
+        Timeline timeline;
+        // Tokens are `_`, `*`, `~` or an ID (expanded) or `<id>,<start>,<length>` (intervals)
+        while (true) {
+            while (pos < line_end && is_blank(*pos)) {
+                ++pos;
+            }
+            if (pos == line_end) {
+                break;
+            }
+            int id = 0;
+            if (*pos == '_') {
+                ++pos;
+            } else if (*pos == '*') {
+                id = SWITCH_ID;
+                ++pos;
+            } else if (*pos == '~') {
+                id = DISPATCH_ID;
+                ++pos;
+            } else if (!parse_int(pos, line_end, id) || id < 0) {
+                throw std::runtime_error("Error reading Gantt chart line " + std::to_string(lines.size() + 1));
+            }
+            long long length = 1;
+            if (pos < line_end && *pos == ',') {
+                long long start;
+                auto parsed = std::from_chars(pos + 1, line_end, start);
+                if (parsed.ec != std::errc() || parsed.ptr == line_end || *parsed.ptr != ',' || start != timeline.end()) {
+                    throw std::runtime_error("Error reading Gantt chart line " + std::to_string(lines.size() + 1));
+                }
+                parsed = std::from_chars(parsed.ptr + 1, line_end, length);
+                if (parsed.ec != std::errc() || length <= 0) {
+                    throw std::runtime_error("Error reading Gantt chart line " + std::to_string(lines.size() + 1));
+                }
+                pos = parsed.ptr;
+            }
+            timeline.append(id, length);
+        }
+        lines.push_back(std::move(timeline));
+        pos = eol == nullptr ? end : eol + 1;
+    }
+    if (lines.size() < cpus) {
+        throw std::runtime_error("The Gantt chart has fewer lines than CPUs");
+    }
+    result.cpu_schedules.assign(std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.begin() + cpus));
+    result.r_schedules.assign(std::make_move_iterator(lines.begin() + cpus), std::make_move_iterator(lines.end()));
+    return result;
+}
+
+// Processes sorted by arrival time (ties keep the input order, i.e. lower ID first) with a
+// cursor to the next process that has not arrived yet. Admitting the arrivals of a time unit
+// costs O(arrivals) instead of a scan over every process.
+// Processes are identified by their index (ID - 1).
+struct ArrivalIndex {
+    const std::vector<int>& arrival_times;
+    std::vector<uint32_t> order;
+    size_t next;
+
+    explicit ArrivalIndex(const std::vector<int>& arrival_times) : arrival_times(arrival_times), next(0) {
+        order.resize(arrival_times.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        // Input files are usually in arrival order already
+        if (!std::is_sorted(arrival_times.begin(), arrival_times.end())) {
+            std::stable_sort(order.begin(), order.end(), [&arrival_times](uint32_t a, uint32_t b) {
+                return arrival_times[a] < arrival_times[b];
+            });
+        }
+    }
+
+    bool pending() const { return next < order.size(); }
+
+    // Arrival time of the next process, only valid if pending()
+    long long next_time() const { return arrival_times[order[next]]; }
+
+    bool arrives_at(long long time) const { return pending() && next_time() == time; }
+
+    uint32_t pop() { return order[next++]; }
+};
+
+// Per-process state of the event-driven engine, one dense array per field, indexed by slot.
+// For a workload in memory slot i is process i (ID i + 1) and the table reads the arrival time
+// and bursts from the workload. A streamed run admits processes as they arrive and releases
+// their slot when they complete, so the table only grows to the largest number of live processes.
+struct ProcessTable {
+    const Workload* workload = nullptr;   // Null for streamed runs
+    std::vector<int> remaining;           // Time left in the current burst
+    std::vector<uint32_t> current_burst;  // Index of the current burst
+    std::vector<uint8_t> just_from_io;    // The process just came from I/O
+    std::vector<uint32_t> home_queue;     // Ready queue the process enters (or returns to)
+    std::vector<double> estimate;         // Predicted length of the next (or current) CPU burst, empty unless predicting
+    double initial_estimate = -1;         // Estimate of a new process, negative when not predicting
+
+    // Streamed runs only: the processes in the slots (burst vectors are reused with their
+    // capacity) and the released slots
+    std::vector<int> ids;
+    std::vector<int> arrival_times;
+    std::vector<std::vector<int>> owned_bursts;
+    std::vector<std::vector<uint8_t>> owned_devices;  // Empty for a process without device classes
+    std::vector<uint32_t> free_slots;
+
+    void reset(const Workload* all) {
+        workload = all;
+        size_t count = all != nullptr ? all->size() : 0;
+        remaining.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            remaining[i] = all->bursts_of(i)[0];
+        }
+        current_burst.assign(count, 0);
+        just_from_io.assign(count, 0);
+        home_queue.assign(count, 0);
+        estimate.assign(initial_estimate >= 0 ? count : 0, initial_estimate);
+        ids.clear();
+        arrival_times.clear();
+        owned_bursts.clear();
+        owned_devices.clear();
+        free_slots.clear();
+    }
+
+    // Take a free slot for a streamed process and return it
+    uint32_t admit(int id, int arrival_time, const std::vector<int>& bursts, const std::vector<uint8_t>& devices) {
+        uint32_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(ids.size());
+            ids.push_back(0);
+            arrival_times.push_back(0);
+            owned_bursts.emplace_back();
+            owned_devices.emplace_back();
+            remaining.push_back(0);
+            current_burst.push_back(0);
+            just_from_io.push_back(0);
+            home_queue.push_back(0);
+            if (initial_estimate >= 0) {
+                estimate.push_back(0);
+            }
+        }
+        ids[slot] = id;
+        arrival_times[slot] = arrival_time;
+        owned_bursts[slot].assign(bursts.begin(), bursts.end());
+        owned_devices[slot].assign(devices.begin(), devices.end());
+        remaining[slot] = bursts.front();
+        current_burst[slot] = 0;
+        just_from_io[slot] = 0;
+        home_queue[slot] = 0;
+        if (initial_estimate >= 0) {
+            estimate[slot] = initial_estimate;
+        }
+        return slot;
+    }
+
+    void release(uint32_t slot) { free_slots.push_back(slot); }
+
+    int id(uint32_t process) const { return workload != nullptr ? static_cast<int>(process + 1) : ids[process]; }
+    int arrival_time(uint32_t process) const { return workload != nullptr ? workload->arrival_times[process] : arrival_times[process]; }
+    size_t burst_count(uint32_t process) const { return workload != nullptr ? workload->burst_count(process) : owned_bursts[process].size(); }
+    int burst(uint32_t process, size_t index) const { return workload != nullptr ? workload->bursts_of(process)[index] : owned_bursts[process][index]; }
+    int device(uint32_t process, size_t index) const {
+        if (workload != nullptr) {
+            return workload->device_of(process, index);
+        }
+        return owned_devices[process].empty() ? 0 : owned_devices[process][index];
+    }
+    // Priority or number of tickets, 1 for streamed processes
+    int weight(uint32_t process) const { return workload != nullptr && !workload->weights.empty() ? workload->weights[process] : 1; }
+};
+
+// Arrival sources: where the event-driven engine takes new processes from, in arrival order.
+// The engine is a template on the source, which has these members:
+//   bool pending();                               // More processes will arrive
+//   long long next_time();                        // Arrival time of the next one, if pending()
+//   bool arrives_at(long long time);              // The next one arrives at `time`
+//   uint32_t admit(ProcessTable& table);          // Put the next one into `table`, return its slot
+//   void release(ProcessTable& table, uint32_t);  // The process in the slot has completed
+//   void save(SnapshotWriter& snapshot) const;    // Its position, for a checkpoint
+//   void restore(SnapshotReader& snapshot);
+
+// Arrivals of a workload held in memory, which the table already holds
+class WorkloadArrivals {
+public:
+    explicit WorkloadArrivals(const Workload& workload) : index(workload.arrival_times) {}
+
+    bool pending() const { return index.pending(); }
+    long long next_time() const { return index.next_time(); }
+    bool arrives_at(long long time) const { return index.arrives_at(time); }
+    uint32_t admit(ProcessTable&) { return index.pop(); }
+    void release(ProcessTable&, uint32_t) {}
+
+    void save(SnapshotWriter& snapshot) const { snapshot.put(index.next); }
+    void restore(SnapshotReader& snapshot) {
+        index.next = snapshot.get();
+        if (index.next > index.order.size()) {
+            throw std::runtime_error("Corrupt checkpoint file");
+        }
+    }
+
+private:
+    ArrivalIndex index;
+};
+
+// Reads a file line by line through a buffer, for input that is not kept in memory. Each read
+// returns whatever is available, so a pipe is consumed as the writer produces it.
+class LineReader {
+public:
+    explicit LineReader(std::FILE* file) : file(file), buffer(1 << 16) {}
+
+    // The next line without its newline; false at the end of the input
+    bool next(const char*& begin, const char*& end) {
+        while (true) {
+            const char* data = buffer.data();
+            const char* eol = static_cast<const char*>(std::memchr(data + start, '\n', filled - start));
+            if (eol != nullptr || (at_end && start < filled)) {
+                begin = data + start;
+                end = eol != nullptr ? eol : data + filled;
+                start = end - data + (eol != nullptr ? 1 : 0);
+                return true;
+            }
+            if (at_end) {
+                return false;
+            }
+
+            // Keep the partial line and read more after it
+            std::memmove(buffer.data(), data + start, filled - start);
+            filled -= start;
+            start = 0;
+            if (filled == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+#ifdef _WIN32
+            size_t count = std::fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+            if (count == 0 && std::ferror(file)) {
+                throw std::runtime_error("Error reading input");
+            }
+#else
+            ssize_t count = read(fileno(file), buffer.data() + filled, buffer.size() - filled);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Error reading input");
+            }
+#endif
+            at_end = count == 0;
+            filled += count;
+        }
+    }
+
+private:
+    std::FILE* file;
+    std::vector<char> buffer;
+    size_t start = 0;   // First unread byte
+    size_t filled = 0;  // End of the data in the buffer
+    bool at_end = false;
+};
+
+// Processes read from a file or pipe while the simulation runs. The lines have the format of the
+// input file and must come in arrival order; the process count on the first line is optional.
+// A process is parsed when the engine needs its arrival time and its slot is freed when it
+// completes.
+class StreamArrivals {
+public:
+    explicit StreamArrivals(std::FILE* input) : lines(input) {}
+
+    bool pending() { return has_next || read_next(); }
+    long long next_time() const { return next_arrival; }
+    bool arrives_at(long long time) { return pending() && next_time() == time; }
+
+    uint32_t admit(ProcessTable& table) {
+        has_next = false;
+        return table.admit(next_id, next_arrival, next_bursts, next_devices);
+    }
+
+    void release(ProcessTable& table, uint32_t slot) { table.release(slot); }
+
+    // The input has been consumed up to an unknown point, possibly from a pipe
+    void save(SnapshotWriter&) const { throw std::runtime_error("Streamed runs cannot be checkpointed"); }
+    void restore(SnapshotReader&) { throw std::runtime_error("Streamed runs cannot be checkpointed"); }
+
+private:
+    LineReader lines;
+    bool seen_first_line = false;
+    bool has_next = false;
+    int next_id = 0;
+    int next_arrival = 0;
+    std::vector<int> next_bursts;
+    std::vector<uint8_t> next_devices;  // Empty if no burst has a device class
+
+    bool read_next() {
+        const char* pos;
+        const char* end;
+        while (lines.next(pos, end)) {
+            const char* p = pos;
+            while (p < end && is_blank(*p)) {
+                ++p;
+            }
+            if (p == end) {
+                continue;
+            }
+
+            int id = next_id + 1;
+            if (!seen_first_line && has_magic(pos, end - pos, WORKLOAD_MAGIC)) {
+                throw std::runtime_error("Binary workloads cannot be streamed");
+            }
+            int arrival_time;
+            if (!parse_int(pos, end, arrival_time)) {
+                throw std::runtime_error("Error reading arrival time for process " + std::to_string(id));
+            }
+            next_bursts.clear();
+            next_devices.clear();
+            int burst;
+            int device;
+            while (parse_burst(pos, end, burst, device)) {
+                if (burst <= 0) {
+                    throw std::runtime_error("Non-positive burst time for process " + std::to_string(id));
+                }
+                next_bursts.push_back(burst);
+                if (device < 0) {
+                    throw std::runtime_error("Invalid device for process " + std::to_string(id));
+                }
+                if (device != 0 && next_bursts.size() % 2 == 1) {
+                    throw std::runtime_error("Device on a CPU burst of process " + std::to_string(id));
+                }
+                if (device != 0) {
+                    next_devices.resize(next_bursts.size());
+                    next_devices.back() = static_cast<uint8_t>(device);
+                }
+            }
+            if (!next_devices.empty()) {
+                next_devices.resize(next_bursts.size());
+            }
+
+            // A first line with a single number is the process count
+            bool first_line = !seen_first_line;
+            seen_first_line = true;
+            if (next_bursts.empty() && first_line) {
+                continue;
+            }
+            if (next_bursts.empty()) {
+                throw std::runtime_error("No bursts read for process " + std::to_string(id));
+            }
+            if (arrival_time < 0) {
+                throw std::runtime_error("Negative arrival time for process " + std::to_string(id));
+            }
+            if (id > 1 && arrival_time < next_arrival) {
+                throw std::runtime_error("Process " + std::to_string(id) + " arrives before process " + std::to_string(id - 1) + ", streamed input must be in arrival order");
+            }
+
+            next_id = id;
+            next_arrival = arrival_time;
+            has_next = true;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Queue entry meaning "no process"
+const uint32_t NO_PROCESS = std::numeric_limits<uint32_t>::max();
+
+// Time slice of a process that may run until its burst completes
+const long long NO_TIME_SLICE = std::numeric_limits<long long>::max();
+
+// Tie-break rules shared by all ready queues: true if `a` goes before `b` when the policy ranks
+// them equal. New arrivals go first, then processes just back from R, then lower ID.
+inline bool enters_first(const ProcessTable& processes, long long current_time, uint32_t a, uint32_t b) {
+    if (processes.arrival_time(a) == current_time && processes.arrival_time(b) != current_time)
+        return true;
+    if (processes.arrival_time(b) == current_time && processes.arrival_time(a) != current_time)
+        return false;
+    if (processes.just_from_io[a] && !processes.just_from_io[b])
+        return true;
+    if (processes.just_from_io[b] && !processes.just_from_io[a])
+        return false;
+    return processes.id(a) < processes.id(b);
+}
+
+// Grow a per-slot array of a ready queue so that `slot` is a valid index
+template <typename T>
+void ensure_slot(std::vector<T>& values, uint32_t slot) {
+    if (slot >= values.size()) {
+        values.resize(std::max<size_t>(slot + 1, values.size() * 2));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Ready queues of the event-driven engine
+//
+// Each scheduling algorithm is a ready queue that decides in which order processes get a CPU.
+// Processes enter it when they arrive, when they finish an R burst and when they are preempted;
+// the engine takes them out when a CPU is free. Processes are identified by their slot in the
+// ProcessTable. `now` is the simulation clock, which the tie-break rules depend on.
+//
+// The engine is a template on the queue type, so the queue operations are resolved at compile
+// time. A ready queue derives from ReadyQueueBase, is constructed from
+// `(const long long& now, const ProcessTable& table, const SimulationConfig& config)` and has:
+//   void arrive(uint32_t process);          // New process, in the time unit of its arrival
+//   void return_from_io(uint32_t process);  // R burst completed in the current time unit
+//   void preempt(uint32_t process);         // Time slice expired in the current time unit
+//   uint32_t pop();
+//   bool empty() const;
+//   size_t size() const;
+//   void save(SnapshotWriter& snapshot) const;  // Its state, for a checkpoint
+//   void restore(SnapshotReader& snapshot);     // The state save() wrote
+// and may replace the defaults of ReadyQueueBase.
+// ---------------------------------------------------------------------------------------------
+
+class ReadyQueueBase {
+public:
+    ReadyQueueBase(const long long& now, const ProcessTable& table) : now(now), table(table) {}
+
+    // Called once per time unit after that time unit's arrivals have entered the queue
+    void arrivals_done() {}
+
+    // Time units `process` may run before it is preempted, from the moment it gets a CPU
+    long long time_slice(uint32_t) const { return NO_TIME_SLICE; }
+
+    // SRTN and MLFQ: if a queued process should replace `running`, queue `running` and return
+    // the replacement, otherwise return NO_PROCESS
+    uint32_t preempt_running(uint32_t) { return NO_PROCESS; }
+
+    // With several CPUs sharing the queue: true if running process `a` is a better candidate
+    // for preemption than running process `b`
+    bool preempt_before(uint32_t a, uint32_t b) const { return table.remaining[a] > table.remaining[b]; }
+
+protected:
+    const long long& now;
+    const ProcessTable& table;
+};
+
+// FCFS: processes returning from R enter the queue in the next time unit, behind the processes
+// arriving in that time unit (new processes win ready-queue conflicts)
+class FcfsQueue : public ReadyQueueBase {
+public:
+    FcfsQueue(const long long& now, const ProcessTable& table, const SimulationConfig&) : ReadyQueueBase(now, table) {}
+
+    void arrive(uint32_t process) { queue.push_back(process); }
+    void return_from_io(uint32_t process) { returning.push_back(process); }
+    void preempt(uint32_t process) { returning.push_back(process); }
+
+    void arrivals_done() {
+        for (uint32_t process : returning) {
+            queue.push_back(process);
+        }
+        returning.clear();
+    }
+
+    uint32_t pop() {
+        uint32_t process = queue.front();
+        queue.pop_front();
+        return process;
+    }
+
+    bool empty() const { return queue.empty() && returning.empty(); }
+    size_t size() const { return queue.size() + returning.size(); }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_values(queue);
+        snapshot.put_values(returning);
+    }
+    void restore(SnapshotReader& snapshot) {
+        snapshot.get_values(queue);
+        snapshot.get_values(returning);
+    }
+
+private:
+    std::deque<uint32_t> queue;
+    std::vector<uint32_t> returning;
+};
+
+// RR: everything entering the queue within a time unit is appended at the start of the next
+// time unit, ordered by the tie-break rules. A non-positive quantum never expires.
+class RoundRobinQueue : public ReadyQueueBase {
+public:
+    RoundRobinQueue(const long long& now, const ProcessTable& table, const SimulationConfig& config)
+        : ReadyQueueBase(now, table), quantum(config.quantum) {}
+
+    void arrive(uint32_t process) { new_processes.push_back(process); }
+    void return_from_io(uint32_t process) { new_processes.push_back(process); }
+    void preempt(uint32_t process) { new_processes.push_back(process); }
+
+    void arrivals_done() {
+        const long long current_time = now;
+        const ProcessTable& processes = table;
+        auto compare_rr = [current_time, &processes](uint32_t a, uint32_t b) {
+            return enters_first(processes, current_time, a, b);
+        };
+        std::sort(new_processes.begin(), new_processes.end(), compare_rr);
+        for (uint32_t process : new_processes) {
+            queue.push_back(process);
+        }
+        new_processes.clear();
+    }
+
+    uint32_t pop() {
+        uint32_t process = queue.front();
+        queue.pop_front();
+        return process;
+    }
+
+    bool empty() const { return queue.empty() && new_processes.empty(); }
+    size_t size() const { return queue.size() + new_processes.size(); }
+
+    long long time_slice(uint32_t) const { return quantum > 0 ? quantum : NO_TIME_SLICE; }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_values(queue);
+        snapshot.put_values(new_processes);
+    }
+    void restore(SnapshotReader& snapshot) {
+        snapshot.get_values(queue);
+        snapshot.get_values(new_processes);
+    }
+
+private:
+    int quantum;
+    std::deque<uint32_t> queue;
+    std::vector<uint32_t> new_processes;
+};
+
+// SJF and SRTN: binary heap on the remaining time of the current CPU burst, which for a queued
+// SJF process is the whole burst; equal times use the tie-break rules. SRTN preempts the
+// running process when a queued one has strictly less time remaining. A real scheduler does not
+// know the bursts in advance: with `predicted` the heap orders on the estimate of the burst
+// (see EventEngine::predict) minus the time already used of it instead.
+template <bool preemptive, bool predicted>
+class ShortestFirstQueue : public ReadyQueueBase {
+public:
+    ShortestFirstQueue(const long long& now, const ProcessTable& table, const SimulationConfig&) : ReadyQueueBase(now, table) {}
+
+    void arrive(uint32_t process) { push(process); }
+    void return_from_io(uint32_t process) { push(process); }
+    void preempt(uint32_t process) { push(process); }
+
+    uint32_t pop() {
+        std::pop_heap(heap.begin(), heap.end(), compare());
+        uint32_t process = heap.back();
+        heap.pop_back();
+        return process;
+    }
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    uint32_t preempt_running(uint32_t running) {
+        if (!preemptive || heap.empty() || expected(table, heap.front()) >= expected(table, running)) {
+            return NO_PROCESS;
+        }
+        push(running);
+        return pop();
+    }
+
+    bool preempt_before(uint32_t a, uint32_t b) const { return expected(table, a) > expected(table, b); }
+
+    // The heap is saved as laid out, so it pops in the same order after a restore
+    void save(SnapshotWriter& snapshot) const { snapshot.put_values(heap); }
+    void restore(SnapshotReader& snapshot) { snapshot.get_values(heap); }
+
+private:
+    std::vector<uint32_t> heap;
+
+    // Time the queue expects `process` to need until its CPU burst completes. With prediction a
+    // process that has run longer than its estimate is expected to finish at once.
+    static auto expected(const ProcessTable& processes, uint32_t process) {
+        if constexpr (predicted) {
+            int used = processes.burst(process, processes.current_burst[process]) - processes.remaining[process];
+            return std::max(0.0, processes.estimate[process] - used);
+        } else {
+            return processes.remaining[process];
+        }
+    }
+
+    void push(uint32_t process) {
+        heap.push_back(process);
+        std::push_heap(heap.begin(), heap.end(), compare());
+    }
+
+    // Heap order: true if `a` runs after `b`
+    struct Compare {
+        const long long& current_time;
+        const ProcessTable& processes;
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            auto a_time = expected(processes, a);
+            auto b_time = expected(processes, b);
+            if (a_time == b_time) {
+                return enters_first(processes, current_time, b, a);
+            }
+            return a_time > b_time;
+        }
+    };
+
+    Compare compare() const { return Compare{now, table}; }
+};
+
+// Min-heap with four children per node over entries that carry their own packed key, so
+// comparisons do not touch the process table. A node's children are 4i + 1 to 4i + 4, which
+// halves the depth of a binary heap and keeps siblings in one cache line.
+class QuaternaryHeap {
+public:
+    struct Entry {
+        uint64_t key;
+        uint32_t process;
+    };
+
+    bool empty() const { return entries.empty(); }
+    size_t size() const { return entries.size(); }
+    const Entry& top() const { return entries.front(); }
+
+    void push(Entry entry) {
+        size_t i = entries.size();
+        entries.push_back(entry);
+        while (i > 0) {
+            size_t parent = (i - 1) / 4;
+            if (entries[parent].key <= entry.key) {
+                break;
+            }
+            entries[i] = entries[parent];
+            i = parent;
+        }
+        entries[i] = entry;
+    }
+
+    Entry pop() {
+        Entry top = entries.front();
+        Entry last = entries.back();
+        entries.pop_back();
+        if (!entries.empty()) {
+            sift_down(last);
+        }
+        return top;
+    }
+
+    // Pop the top and push `entry` with a single pass down the heap
+    Entry replace_top(Entry entry) {
+        Entry top = entries.front();
+        sift_down(entry);
+        return top;
+    }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put(entries.size());
+        for (const Entry& entry : entries) {
+            snapshot.put(entry.key);
+            snapshot.put(entry.process);
+        }
+    }
+    void restore(SnapshotReader& snapshot) {
+        entries.resize(snapshot.get());
+        for (Entry& entry : entries) {
+            entry.key = snapshot.get();
+            entry.process = static_cast<uint32_t>(snapshot.get());
+        }
+    }
+
+private:
+    std::vector<Entry> entries;
+
+    // Place `entry` at the root and move it down to its position
+    void sift_down(Entry entry) {
+        size_t size = entries.size();
+        size_t i = 0;
+        while (true) {
+            size_t first = 4 * i + 1;
+            if (first >= size) {
+                break;
+            }
+            size_t best = first;
+            size_t last = std::min(first + 4, size);
+            for (size_t c = first + 1; c < last; c++) {
+                if (entries[c].key < entries[best].key) {
+                    best = c;
+                }
+            }
+            if (entries[best].key >= entry.key) {
+                break;
+            }
+            entries[i] = entries[best];
+            i = best;
+        }
+        entries[i] = entry;
+    }
+};
+
+// SJF and SRTN on packed keys: remaining time, then the tie-break rank, then the ID, in one
+// 64-bit integer, so the order is decided without looking at the process table. A process
+// that arrives in the current time unit goes before an equal one that does not, but only in
+// that time unit; arrivals wait in their own heap until the clock moves on and then join the
+// others with the rank of any process. Preempting the running process swaps it with the top
+// of the heap in one sift.
+//
+// The tie-break rules are applied when a process is picked. ShortestFirstQueue compares with
+// the clock of the moment two processes meet in the heap, which the tick engine does as well,
+// so the two can order processes with equal times differently. ShortestFirstQueue stays the
+// default for that reason.
+template <bool preemptive>
+class PackedShortestFirstQueue : public ReadyQueueBase {
+public:
+    PackedShortestFirstQueue(const long long& now, const ProcessTable& table, const SimulationConfig&) : ReadyQueueBase(now, table) {}
+
+    void arrive(uint32_t process) { push(process); }
+    void return_from_io(uint32_t process) { push(process); }
+    void preempt(uint32_t process) { push(process); }
+
+    uint32_t pop() {
+        settle();
+        if (arriving.empty() || (!waiting.empty() && waiting.top().key < arriving.top().key)) {
+            return waiting.pop().process;
+        }
+        return arriving.pop().process;
+    }
+
+    bool empty() const { return waiting.empty() && arriving.empty(); }
+    size_t size() const { return waiting.size() + arriving.size(); }
+
+    uint32_t preempt_running(uint32_t running) {
+        if (!preemptive || empty()) {
+            return NO_PROCESS;
+        }
+        settle();
+        QuaternaryHeap& best = arriving.empty() || (!waiting.empty() && waiting.top().key < arriving.top().key) ? waiting : arriving;
+        if (best.top().key >> REMAINING_SHIFT >= static_cast<uint64_t>(table.remaining[running])) {
+            return NO_PROCESS;
+        }
+        // The running process goes into the heap it belongs to; swap it in if that is `best`
+        if (table.arrival_time(running) == now) {
+            if (&best == &arriving) {
+                return arriving.replace_top({key(running, ARRIVING), running}).process;
+            }
+        } else if (&best == &waiting) {
+            return waiting.replace_top({key(running, rank(running)), running}).process;
+        }
+        uint32_t replacement = best.pop().process;
+        push(running);
+        return replacement;
+    }
+
+    void save(SnapshotWriter& snapshot) const {
+        waiting.save(snapshot);
+        arriving.save(snapshot);
+        snapshot.put_signed(arrived_at);
+    }
+    void restore(SnapshotReader& snapshot) {
+        waiting.restore(snapshot);
+        arriving.restore(snapshot);
+        arrived_at = snapshot.get_signed();
+    }
+
+private:
+    // Key layout: remaining time in bits 33 to 63, rank in bits 31 and 32, ID in bits 0 to 30
+    static const int REMAINING_SHIFT = 33;
+    static const int RANK_SHIFT = 31;
+    static const uint64_t ARRIVING = 0, FROM_IO = 1, OTHER = 2;
+
+    QuaternaryHeap waiting;
+    QuaternaryHeap arriving;       // Processes that arrived at `arrived_at`
+    long long arrived_at = -1;
+
+    uint64_t rank(uint32_t process) const { return table.just_from_io[process] ? FROM_IO : OTHER; }
+
+    uint64_t key(uint32_t process, uint64_t rank) const {
+        return static_cast<uint64_t>(table.remaining[process]) << REMAINING_SHIFT | rank << RANK_SHIFT | static_cast<uint64_t>(table.id(process));
+    }
+
+    void push(uint32_t process) {
+        settle();
+        if (table.arrival_time(process) == now) {
+            arriving.push({key(process, ARRIVING), process});
+            arrived_at = now;
+        } else {
+            waiting.push({key(process, rank(process)), process});
+        }
+    }
+
+    // Once the clock has moved past their arrival, earlier arrivals rank like any other process
+    void settle() {
+        if (arrived_at == now) {
+            return;
+        }
+        while (!arriving.empty()) {
+            uint32_t process = arriving.pop().process;
+            waiting.push({key(process, rank(process)), process});
+        }
+        arrived_at = now;
+    }
+};
+
+// MLFQ: `levels` round-robin queues. The top level has the base quantum and every level below
+// twice the quantum of the one above. Processes start at the top and drop one level each time
+// they use up their quantum; a process returning from R keeps its level. A queued process in a
+// higher level preempts a running one in a lower level. With a boost period every process goes
+// back to the top level every `boost` time units, so long jobs cannot starve.
+class MultilevelFeedbackQueue : public ReadyQueueBase {
+public:
+    MultilevelFeedbackQueue(const long long& now, const ProcessTable& table, const SimulationConfig& config)
+        : ReadyQueueBase(now, table), quantum(config.quantum), boost(config.mlfq_boost), queues(std::max(1, config.mlfq_levels)) {}
+
+    void arrive(uint32_t process) {
+        set_level(process, 0);
+        entering.push_back(process);
+    }
+    void return_from_io(uint32_t process) { entering.push_back(process); }
+    void preempt(uint32_t process) {
+        set_level(process, std::min<int>(level_of(process) + 1, queues.size() - 1));
+        entering.push_back(process);
+    }
+
+    void arrivals_done() {
+        if (boost > 0 && now >= next_boost) {
+            // Queued processes keep their order, the others find out when they come back
+            for (size_t level = 1; level < queues.size(); level++) {
+                queues[0].insert(queues[0].end(), queues[level].begin(), queues[level].end());
+                queues[level].clear();
+            }
+            epoch++;
+            next_boost = (now / boost + 1) * boost;
+        }
+
+        const long long current_time = now;
+        const ProcessTable& processes = table;
+        std::sort(entering.begin(), entering.end(), [current_time, &processes](uint32_t a, uint32_t b) {
+            return enters_first(processes, current_time, a, b);
+        });
+        for (uint32_t process : entering) {
+            queues[level_of(process)].push_back(process);
+        }
+        queued += entering.size();
+        entering.clear();
+    }
+
+    uint32_t pop() {
+        for (auto& queue : queues) {
+            if (!queue.empty()) {
+                uint32_t process = queue.front();
+                queue.pop_front();
+                queued--;
+                return process;
+            }
+        }
+        return NO_PROCESS;
+    }
+
+    bool empty() const { return queued == 0 && entering.empty(); }
+    size_t size() const { return queued + entering.size(); }
+
+    long long time_slice(uint32_t process) const {
+        if (quantum <= 0) {
+            return NO_TIME_SLICE;
+        }
+        return static_cast<long long>(quantum) << std::min(level_of(process), 32);
+    }
+
+    uint32_t preempt_running(uint32_t running) {
+        int level = level_of(running);
+        for (int higher = 0; higher < level; higher++) {
+            if (!queues[higher].empty()) {
+                queues[level].push_back(running);
+                queued++;
+                return pop();
+            }
+        }
+        return NO_PROCESS;
+    }
+
+    bool preempt_before(uint32_t a, uint32_t b) const {
+        if (level_of(a) != level_of(b)) {
+            return level_of(a) > level_of(b);
+        }
+        return table.remaining[a] > table.remaining[b];
+    }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_signed(next_boost);
+        snapshot.put(epoch);
+        for (const auto& queue : queues) {
+            snapshot.put_values(queue);
+        }
+        snapshot.put_values(entering);
+        snapshot.put(queued);
+        snapshot.put_values(levels);
+        snapshot.put_values(level_epochs);
+    }
+    void restore(SnapshotReader& snapshot) {
+        next_boost = snapshot.get_signed();
+        epoch = static_cast<uint32_t>(snapshot.get());
+        for (auto& queue : queues) {
+            snapshot.get_values(queue);
+        }
+        snapshot.get_values(entering);
+        queued = snapshot.get();
+        snapshot.get_values(levels);
+        snapshot.get_values(level_epochs);
+        if (levels.size() != level_epochs.size()) {
+            throw std::runtime_error("Corrupt checkpoint file");
+        }
+    }
+
+private:
+    int quantum;
+    long long boost;
+    long long next_boost = 0;
+    uint32_t epoch = 0;              // Number of boosts so far
+    std::vector<std::deque<uint32_t>> queues;
+    std::vector<uint32_t> entering;  // Enter their level at the start of the next time unit
+    size_t queued = 0;               // Processes in `queues`
+    std::vector<int> levels;         // Per slot, valid if set in the current epoch
+    std::vector<uint32_t> level_epochs;
+
+    int level_of(uint32_t process) const {
+        return process < levels.size() && level_epochs[process] == epoch ? levels[process] : 0;
+    }
+
+    void set_level(uint32_t process, int level) {
+        ensure_slot(levels, process);
+        ensure_slot(level_epochs, process);
+        levels[process] = level;
+        level_epochs[process] = epoch;
+    }
+};
+
+// Priority with aging (non-preemptive): the ready process with the highest priority runs next,
+// where the priority of a waiting process is its weight plus one for every whole `aging` time
+// units it has waited; equal priorities use the tie-break rules. A process that became ready at
+// r = q * aging + m has priority weight - q + t / aging at time t, less one while t % aging < m.
+// So the processes are kept in one heap per phase m on the fixed key weight - q, the leaves of a
+// segment tree over the phases that holds the best heap top of every range, and pop() compares
+// the best of the phases up to t % aging with the best of the others. The processes that arrive
+// in the current time unit, which the tie-break rules put first, wait in `arrivals` until the
+// time moves on, so the heaps never depend on the time. Without aging the key is the weight
+// alone and equal weights are served in order of entry, then by the tie-break rules.
+class PriorityAgingQueue : public ReadyQueueBase {
+public:
+    PriorityAgingQueue(const long long& now, const ProcessTable& table, const SimulationConfig& config)
+        : ReadyQueueBase(now, table), aging(config.aging) {
+        while (phase_span < aging) {
+            phase_span *= 2;
+        }
+    }
+
+    void arrive(uint32_t process) {
+        settle_arrivals();
+        set_key(process);
+        arrivals.push_back(process);
+        count++;
+    }
+    void return_from_io(uint32_t process) { push(process); }
+    void preempt(uint32_t process) { push(process); }
+
+    uint32_t pop() {
+        settle_arrivals();
+        // Best of the phases that have gained a level in the current round of `aging` time
+        // units and best of the others, whose priority is one less (both less t / aging)
+        long long phase_now = aging > 0 ? now % aging : 0;
+        uint32_t gained = NO_PROCESS;
+        uint32_t pending = NO_PROCESS;
+        uint32_t node = 0;
+        for (long long low = 0, size = phase_span;; size /= 2) {
+            if (size == 1) {
+                gained = better(gained, tops[node].best);
+                break;
+            }
+            const TopNode& range = tops[node];
+            if (phase_now >= low + size / 2) {
+                gained = better(gained, range.children[0] == 0 ? NO_PROCESS : tops[range.children[0]].best);
+                node = range.children[1];
+                low += size / 2;
+            } else {
+                pending = better(pending, range.children[1] == 0 ? NO_PROCESS : tops[range.children[1]].best);
+                node = range.children[0];
+            }
+            if (node == 0) {
+                break;  // No phase in use down this side
+            }
+        }
+        uint32_t best = gained;
+        if (pending != NO_PROCESS &&
+            (gained == NO_PROCESS || keys[pending] - 1 > keys[gained] || (keys[pending] - 1 == keys[gained] && enters_first(table, now, pending, gained)))) {
+            best = pending;
+        }
+        long long best_priority = best == NO_PROCESS ? 0 : keys[best] - (best == pending ? 1 : 0);
+        // An arrival of this time unit has waited for nothing, so its priority is its key
+        size_t arrival = arrivals.size();
+        for (size_t i = 0; i < arrivals.size(); i++) {
+            if (arrival == arrivals.size() || keys[arrivals[i]] > keys[arrivals[arrival]] ||
+                (keys[arrivals[i]] == keys[arrivals[arrival]] && table.id(arrivals[i]) < table.id(arrivals[arrival]))) {
+                arrival = i;
+            }
+        }
+        count--;
+        // New arrivals win ties, unless without aging the order of entry puts an earlier process first
+        if (arrival < arrivals.size() &&
+            (best == NO_PROCESS || keys[arrivals[arrival]] > best_priority ||
+             (keys[arrivals[arrival]] == best_priority && (aging > 0 || ready_since[best] == now)))) {
+            uint32_t process = arrivals[arrival];
+            arrivals.erase(arrivals.begin() + static_cast<std::ptrdiff_t>(arrival));
+            return process;
+        }
+        Path path;
+        std::vector<uint32_t>& heap = heaps[tops[leaf(phase_of(best), path)].heap];
+        std::pop_heap(heap.begin(), heap.end(), compare());
+        heap.pop_back();
+        refresh(path);
+        return best;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_values(heap_phases);
+        for (const auto& heap : heaps) {
+            snapshot.put_values(heap);
+        }
+        snapshot.put_values(arrivals);
+        snapshot.put_signed(arrivals_time);
+        snapshot.put_values(keys);
+        snapshot.put_values(ready_since);
+    }
+    void restore(SnapshotReader& snapshot) {
+        std::vector<long long> phases;
+        snapshot.get_values(phases);
+        tops.assign(1, TopNode());
+        heaps.clear();
+        heap_phases.clear();
+        count = 0;
+        for (long long phase : phases) {
+            if (phase < 0 || phase >= phase_span) {
+                throw std::runtime_error("Corrupt checkpoint file");
+            }
+            Path path;
+            snapshot.get_values(heaps[tops[leaf(phase, path)].heap]);
+            count += heaps.back().size();
+            refresh(path);
+        }
+        snapshot.get_values(arrivals);
+        arrivals_time = snapshot.get_signed();
+        count += arrivals.size();
+        snapshot.get_values(keys);
+        snapshot.get_values(ready_since);
+    }
+
+private:
+    // Segment tree over the phases 0 .. phase_span - 1 holding the best heap top of every range,
+    // in heap order. Nodes are created as phases are first used; node 0 is the root.
+    struct TopNode {
+        uint32_t best = NO_PROCESS;
+        uint32_t children[2] = {0, 0};  // 0 = none
+        uint32_t heap = NO_PROCESS;     // Leaves: index in `heaps`
+    };
+    // Nodes from the root down to a leaf
+    struct Path {
+        uint32_t nodes[64];
+        int depth = 0;
+    };
+
+    int aging;
+    long long phase_span = 1;
+    std::vector<TopNode> tops = std::vector<TopNode>(1);
+    std::vector<std::vector<uint32_t>> heaps;  // Per phase in use, in heap order
+    std::vector<long long> heap_phases;        // Phase of every heap
+    std::vector<uint32_t> arrivals;  // Arrived at `arrivals_time`, not in a heap yet
+    long long arrivals_time = 0;
+    size_t count = 0;
+    std::vector<long long> keys;         // Per slot
+    std::vector<long long> ready_since;  // Per slot
+
+    void set_key(uint32_t process) {
+        ensure_slot(keys, process);
+        ensure_slot(ready_since, process);
+        long long weight = table.weight(process);
+        keys[process] = aging > 0 ? weight - now / aging : weight;
+        ready_since[process] = now;
+    }
+
+    void push(uint32_t process) {
+        settle_arrivals();
+        set_key(process);
+        push_heap(process);
+        count++;
+    }
+
+    long long phase_of(uint32_t process) const { return aging > 0 ? ready_since[process] % aging : 0; }
+
+    void push_heap(uint32_t process) {
+        Path path;
+        std::vector<uint32_t>& heap = heaps[tops[leaf(phase_of(process), path)].heap];
+        heap.push_back(process);
+        std::push_heap(heap.begin(), heap.end(), compare());
+        refresh(path);
+    }
+
+    // Once the time has moved on, the arrivals are ranked like any other waiting process
+    void settle_arrivals() {
+        if (arrivals_time != now) {
+            for (uint32_t process : arrivals) {
+                push_heap(process);
+            }
+            arrivals.clear();
+            arrivals_time = now;
+        }
+    }
+
+    // The leaf of `phase`, created with an empty heap if needed, and the path down to it
+    uint32_t leaf(long long phase, Path& path) {
+        uint32_t node = 0;
+        for (long long low = 0, size = phase_span; size > 1; size /= 2) {
+            int side = phase >= low + size / 2 ? 1 : 0;
+            low += side * (size / 2);
+            path.nodes[path.depth++] = node;
+            if (tops[node].children[side] == 0) {
+                tops[node].children[side] = static_cast<uint32_t>(tops.size());
+                tops.emplace_back();
+            }
+            node = tops[node].children[side];
+        }
+        path.nodes[path.depth++] = node;
+        if (tops[node].heap == NO_PROCESS) {
+            tops[node].heap = static_cast<uint32_t>(heaps.size());
+            heaps.emplace_back();
+            heap_phases.push_back(phase);
+        }
+        return node;
+    }
+
+    // Take the new top of the heap at the end of `path` up the tree
+    void refresh(Path& path) {
+        uint32_t node = path.nodes[--path.depth];
+        const std::vector<uint32_t>& heap = heaps[tops[node].heap];
+        tops[node].best = heap.empty() ? NO_PROCESS : heap.front();
+        while (path.depth > 0) {
+            node = path.nodes[--path.depth];
+            const TopNode& parent = tops[node];
+            uint32_t left = parent.children[0] == 0 ? NO_PROCESS : tops[parent.children[0]].best;
+            uint32_t right = parent.children[1] == 0 ? NO_PROCESS : tops[parent.children[1]].best;
+            uint32_t best = better(left, right);
+            if (best == parent.best) {
+                break;  // The ranges further up are unchanged
+            }
+            tops[node].best = best;
+        }
+    }
+
+    // The better of two heap tops (NO_PROCESS for none)
+    uint32_t better(uint32_t a, uint32_t b) const {
+        if (a == NO_PROCESS) {
+            return b;
+        }
+        return b == NO_PROCESS || compare()(b, a) ? a : b;
+    }
+
+    // Heap order within a phase: true if `a` runs after `b`. No process in a heap arrived in the
+    // current time unit, so the tie-break rules come down to processes back from R, then ID.
+    struct Compare {
+        const ProcessTable& processes;
+        const std::vector<long long>& keys;
+        const std::vector<long long>& ready_since;
+        bool aging;
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            if (keys[a] != keys[b]) {
+                return keys[a] < keys[b];
+            }
+            if (!aging && ready_since[a] != ready_since[b]) {
+                return ready_since[a] > ready_since[b];
+            }
+            if (processes.just_from_io[a] != processes.just_from_io[b]) {
+                return processes.just_from_io[b];
+            }
+            return processes.id(a) > processes.id(b);
+        }
+    };
+
+    Compare compare() const { return Compare{table, keys, ready_since, aging > 0}; }
+};
+
+// Lottery: whenever a CPU is free, a ready process is drawn at random with a probability
+// proportional to its weight (its tickets) and runs for at most one quantum. The tickets of the
+// queued processes are kept in a Fenwick tree indexed by process ID from `base`, so a draw costs
+// O(log IDs) and its winner only depends on the seed and the queued IDs, not on the process
+// table slots: runs are reproducible, and a --stream run draws like the same trace in memory.
+// The tree spans the IDs of the queued processes and is rebuilt when they move out of it.
+class LotteryQueue : public ReadyQueueBase {
+public:
+    LotteryQueue(const long long& now, const ProcessTable& table, const SimulationConfig& config)
+        : ReadyQueueBase(now, table), quantum(config.quantum), rng(config.seed) {}
+
+    void arrive(uint32_t process) { add(process); }
+    void return_from_io(uint32_t process) { add(process); }
+    void preempt(uint32_t process) { add(process); }
+
+    uint32_t pop() {
+        long long ticket = std::uniform_int_distribution<long long>(0, total - 1)(rng);
+        // Descend the tree to the index holding `ticket`
+        size_t index = 0;
+        for (size_t step = tree.size() / 2; step > 0; step /= 2) {
+            if (index + step < tree.size() && tree[index + step] <= ticket) {
+                index += step;
+                ticket -= tree[index];
+            }
+        }
+        // Tree index index + 1
+        update(index, -tickets[index]);
+        tickets[index] = 0;
+        count--;
+        return slots[index];
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    long long time_slice(uint32_t) const { return quantum > 0 ? quantum : NO_TIME_SLICE; }
+
+    void save(SnapshotWriter& snapshot) const {
+        std::ostringstream state;
+        state << rng;
+        snapshot.put_string(state.str());
+        snapshot.put_signed(base);
+        snapshot.put_values(tree);
+        snapshot.put_values(tickets);
+        snapshot.put_values(slots);
+        snapshot.put_signed(total);
+        snapshot.put(count);
+    }
+    void restore(SnapshotReader& snapshot) {
+        std::istringstream state(snapshot.get_string());
+        state >> rng;
+        base = snapshot.get_signed();
+        snapshot.get_values(tree);
+        snapshot.get_values(tickets);
+        snapshot.get_values(slots);
+        total = snapshot.get_signed();
+        count = snapshot.get();
+        if (!state || tree.empty() || tickets.size() != tree.size() - 1 || slots.size() != tickets.size()) {
+            throw std::runtime_error("Corrupt checkpoint file");
+        }
+    }
+
+private:
+    int quantum;
+    std::mt19937_64 rng;
+    long long base = 0;                                       // Process ID of index 0
+    std::vector<long long> tree = std::vector<long long>(1);  // 1-based, size a power of two
+    std::vector<long long> tickets;                           // Per ID - base, 0 if not queued
+    std::vector<uint32_t> slots;                              // Per ID - base, process table slot
+    long long total = 0;
+    size_t count = 0;
+
+    void add(uint32_t process) {
+        long long id = table.id(process);
+        if (count == 0) {
+            base = id;  // The tree is all zero, any base will do
+        }
+        if (id < base || id - base >= static_cast<long long>(tickets.size())) {
+            rebuild(id);
+        }
+        size_t index = static_cast<size_t>(id - base);
+        tickets[index] = table.weight(process);
+        slots[index] = process;
+        update(index, tickets[index]);
+        count++;
+    }
+
+    // Move the tree to cover the queued IDs and `id`, with twice the room they need so that
+    // rebuilds stay rare while IDs keep growing
+    void rebuild(long long id) {
+        long long low = id;
+        long long high = id;
+        for (size_t index = 0; index < tickets.size(); index++) {
+            if (tickets[index] > 0) {
+                low = std::min(low, base + static_cast<long long>(index));
+                high = std::max(high, base + static_cast<long long>(index));
+            }
+        }
+        size_t capacity = 2;
+        while (static_cast<long long>(capacity - 1) < 2 * (high - low + 1)) {
+            capacity *= 2;
+        }
+        std::vector<long long> old_tickets(capacity - 1, 0);
+        std::vector<uint32_t> old_slots(capacity - 1, 0);
+        old_tickets.swap(tickets);
+        old_slots.swap(slots);
+        for (size_t index = 0; index < old_tickets.size(); index++) {
+            if (old_tickets[index] > 0) {
+                size_t moved = static_cast<size_t>(base + static_cast<long long>(index) - low);
+                tickets[moved] = old_tickets[index];
+                slots[moved] = old_slots[index];
+            }
+        }
+        base = low;
+        tree.assign(capacity, 0);
+        total = 0;
+        for (size_t index = 0; index < tickets.size(); index++) {
+            if (tickets[index] > 0) {
+                update(index, tickets[index]);
+            }
+        }
+    }
+
+    void update(size_t index, long long delta) {
+        total += delta;
+        for (size_t i = index + 1; i < tree.size(); i += i & (~i + 1)) {
+            tree[i] += delta;
+        }
+    }
+};
+
+// Stride: every process has a pass value and a stride inversely proportional to its weight. The
+// ready process with the lowest pass runs for at most one quantum and its pass advances by its
+// stride. Arriving and returning processes start no lower than the pass of the last dispatched
+// process, so they cannot monopolize the CPU. Equal passes use the tie-break rules.
+class StrideQueue : public ReadyQueueBase {
+public:
+    StrideQueue(const long long& now, const ProcessTable& table, const SimulationConfig& config)
+        : ReadyQueueBase(now, table), quantum(config.quantum) {}
+
+    void arrive(uint32_t process) {
+        ensure_slot(passes, process);
+        passes[process] = global_pass;
+        push(process);
+    }
+    void return_from_io(uint32_t process) {
+        ensure_slot(passes, process);
+        passes[process] = std::max(passes[process], global_pass);
+        push(process);
+    }
+    void preempt(uint32_t process) {
+        ensure_slot(passes, process);
+        push(process);
+    }
+
+    uint32_t pop() {
+        std::pop_heap(heap.begin(), heap.end(), compare());
+        uint32_t process = heap.back();
+        heap.pop_back();
+        global_pass = passes[process];
+        passes[process] += STRIDE_ONE / table.weight(process);
+        return process;
+    }
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    long long time_slice(uint32_t) const { return quantum > 0 ? quantum : NO_TIME_SLICE; }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_signed(global_pass);
+        snapshot.put_values(heap);
+        snapshot.put_values(passes);
+    }
+    void restore(SnapshotReader& snapshot) {
+        global_pass = snapshot.get_signed();
+        snapshot.get_values(heap);
+        snapshot.get_values(passes);
+    }
+
+private:
+    static constexpr long long STRIDE_ONE = 1 << 20;  // Stride of a process with weight 1
+
+    int quantum;
+    long long global_pass = 0;
+    std::vector<uint32_t> heap;
+    std::vector<long long> passes;  // Per slot
+
+    void push(uint32_t process) {
+        heap.push_back(process);
+        std::push_heap(heap.begin(), heap.end(), compare());
+    }
+
+    // Heap order: true if `a` runs after `b`
+    struct Compare {
+        const long long& current_time;
+        const ProcessTable& processes;
+        const std::vector<long long>& passes;
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            if (passes[a] != passes[b]) {
+                return passes[a] > passes[b];
+            }
+            return enters_first(processes, current_time, b, a);
+        }
+    };
+
+    Compare compare() const { return Compare{now, table, passes}; }
+};
+
+// Processes waiting for one device class. FCFS and round robin serve them in order of entry;
+// SSTF serves the shortest remaining device burst first, then the lower ID. Device bursts are
+// never preempted by an entering process, round robin only requeues a process whose quantum
+// has expired.
+class DeviceQueue {
+public:
+    explicit DeviceQueue(DevicePolicy policy) : policy(policy) {}
+
+    void push(uint32_t process, int remaining, int id) {
+        if (policy == DevicePolicy::Sstf) {
+            shortest.push({static_cast<uint64_t>(remaining) << 32 | static_cast<uint32_t>(id), process});
+        } else {
+            fifo.push_back(process);
+        }
+    }
+
+    uint32_t pop() {
+        if (policy == DevicePolicy::Sstf) {
+            return shortest.pop().process;
+        }
+        uint32_t process = fifo.front();
+        fifo.pop_front();
+        return process;
+    }
+
+    bool empty() const { return fifo.empty() && shortest.empty(); }
+    size_t size() const { return fifo.size() + shortest.size(); }
+
+    void save(SnapshotWriter& snapshot) const {
+        snapshot.put_values(fifo);
+        shortest.save(snapshot);
+    }
+    void restore(SnapshotReader& snapshot) {
+        snapshot.get_values(fifo);
+        shortest.restore(snapshot);
+    }
+
+private:
+    DevicePolicy policy;
+    std::deque<uint32_t> fifo;  // FCFS and round robin
+    QuaternaryHeap shortest;    // SSTF
+};
+
+// A single simulation run. All scheduling state lives in the object, so independent simulations
+// of the same (shared, read-only) workload can run concurrently on different threads.
+class Simulator {
+public:
+    // With a `gantt_writer` the Gantt chart is streamed to it instead of kept in the result
+    Simulator(const Workload& workload, const SimulationConfig& config, GanttWriter* gantt_writer = nullptr)
+        : workload(workload), config(config), gantt_writer(gantt_writer) {}
+
+    // With `stream` (event engine only) the processes are read from it instead of taken from
+    // the workload, and the metrics only hold the totals, not the timing of every process
+    SimulationResult run(StreamArrivals* stream = nullptr);
+
+private:
+    const Workload& workload;
+    SimulationConfig config;
+    GanttWriter* gantt_writer;
+
+    std::vector<Process> processes;  // Tick engine only: private copy of the workload, bursts are consumed while running
+    std::vector<Timeline> cpu_schedules;
+    std::vector<Timeline> r_schedules;
+    long long current_time = 0;
+    size_t completed = 0;
+    Metrics metrics;
+#ifdef SCHEDULER_PROFILE
+    Profile profile;  // Event engine only
+#endif
+    bool process_metrics = true;  // Collect ProcessMetrics for every process
+    std::vector<int> last_cpu_process;  // ID per CPU (0 = none yet), for counting context switches
+    std::vector<uint32_t> resource_device;  // Device class of every R instance
+
+    // Tick-based schedulers (one CPU, one R)
+    Process* current_cpu_process = nullptr;
+    Process* current_io_process = nullptr;
+    bool io_exec_flag = true; // Assign to R schedule only if this is true
+
+    void record_cpu(size_t cpu, int id, long long length = 1);
+    void record_r(size_t resource, int id, long long length = 1);
+    void complete(int id);
+
+    void fcfs_scheduler();
+    void rr_scheduler(int quantum);
+    void sjf_scheduler();
+    void srtn_scheduler();
+
+    // Event-driven engine, `in_memory` is null for streamed runs
+    template <typename Arrivals>
+    void event_scheduler(Arrivals& arrivals, const Workload* in_memory);
+    template <typename Queue, typename Arrivals>
+    friend class EventEngine;
+};
+
+SimulationResult Simulator::run(StreamArrivals* stream) {
+    if (config.cpus < 1 || config.resources < 1) {
+        throw std::runtime_error("The number of CPUs and R instances must be at least 1");
+    }
+    if (config.tick_engine && (config.cpus != 1 || config.resources != 1)) {
+        throw std::runtime_error("The tick engine only simulates one CPU and one R");
+    }
+    if (config.tick_engine && stream != nullptr) {
+        throw std::runtime_error("The tick engine cannot stream its input");
+    }
+    if (!config.checkpoint_file.empty() && (config.tick_engine || stream != nullptr)) {
+        throw std::runtime_error("Only the event engine with the workload in memory can be checkpointed");
+    }
+    if (config.predict_bursts && (config.tick_engine || (config.algorithm != 3 && config.algorithm != 4))) {
+        throw std::runtime_error("Burst prediction only applies to SJF and SRTN on the event engine");
+    }
+    if (config.predict_bursts && (config.alpha < 0 || config.alpha > 1 || config.initial_estimate < 0)) {
+        throw std::runtime_error("The prediction weight must be between 0 and 1 and the initial estimate at least 0");
+    }
+    if (config.tick_engine && (!config.devices.empty() || !workload.devices.empty())) {
+        throw std::runtime_error("The tick engine does not simulate device classes");
+    }
+    if (config.switch_cost < 0 || config.dispatch_latency < 0) {
+        throw std::runtime_error("The context switch cost and dispatch latency must be at least 0");
+    }
+    if (config.tick_engine && config.models_overhead()) {
+        throw std::runtime_error("The tick engine does not model context switch and dispatch costs");
+    }
+    std::vector<DeviceConfig> devices = config.device_classes();
+    resource_device.clear();
+    for (size_t d = 0; d < devices.size(); d++) {
+        if (devices[d].instances < 1) {
+            throw std::runtime_error("Every device class needs at least one instance");
+        }
+        resource_device.insert(resource_device.end(), devices[d].instances, static_cast<uint32_t>(d));
+    }
+    if (resource_device.size() != static_cast<size_t>(config.resources)) {
+        throw std::runtime_error("The device classes must have as many instances as there are R instances");
+    }
+
+    cpu_schedules.assign(config.cpus, Timeline());
+    r_schedules.assign(config.resources, Timeline());
+    current_time = 0;
+    completed = 0;
+    current_cpu_process = nullptr;
+    current_io_process = nullptr;
+    io_exec_flag = true;
+    last_cpu_process.assign(config.cpus, 0);
+    metrics = Metrics();
+#ifdef SCHEDULER_PROFILE
+    profile = Profile();
+#endif
+    metrics.cpus = config.cpus;
+    metrics.resources = config.resources;
+    metrics.overhead = config.models_overhead();
+    if (!config.devices.empty()) {
+        metrics.device_busy.assign(devices.size(), 0);
+        for (const auto& device : devices) {
+            metrics.device_instances.push_back(device.instances);
+        }
+    }
+    process_metrics = stream == nullptr;
+    metrics.processes.reserve(workload.size());
+    for (size_t i = 0; i < workload.size(); i++) {
+        const int* bursts = workload.bursts_of(i);
+        long long service_time = 0;
+        for (size_t b = 0; b < workload.burst_count(i); b++) {
+            service_time += bursts[b];
+        }
+        metrics.processes.push_back({static_cast<int>(i + 1), workload.arrival_times[i], service_time});
+    }
+
+    if (!config.tick_engine) {
+        if (stream != nullptr) {
+            event_scheduler(*stream, nullptr);
+        } else {
+            WorkloadArrivals arrivals(workload);
+            event_scheduler(arrivals, &workload);
+        }
+    } else {
+        processes.clear();
+        processes.reserve(workload.size());
+        for (size_t i = 0; i < workload.size(); i++) {
+            Process process(static_cast<int>(i + 1), workload.arrival_times[i]);
+            process.bursts.assign(workload.bursts_of(i), workload.bursts_of(i) + workload.burst_count(i));
+            process.remaining_time = process.bursts.front();
+            processes.push_back(std::move(process));
+        }
+
+        switch (config.algorithm) {
+            case 1:
+                fcfs_scheduler();
+                break;
+            case 2:
+                rr_scheduler(config.quantum);
+                break;
+            case 3:
+                sjf_scheduler();
+                break;
+            case 4:
+                srtn_scheduler();
+                break;
+            default:
+                throw std::runtime_error("The tick engine only implements algorithms 1 to 4");
+        }
+    }
+
+    metrics.makespan = current_time;
+
+    SimulationResult result;
+    result.cpu_schedules = std::move(cpu_schedules);
+    result.r_schedules = std::move(r_schedules);
+    result.metrics = std::move(metrics);
+#ifdef SCHEDULER_PROFILE
+    result.profile = profile;
+#endif
+    return result;
+}
+
+// Record process `id` (0 = idle) on `cpu` for the `length` time units ending with the current
+// one
+void Simulator::record_cpu(size_t cpu, int id, long long length) {
+    if (gantt_writer != nullptr) {
+        gantt_writer->append_cpu(cpu, id, length);
+    } else if (config.record_gantt) {
+        cpu_schedules[cpu].append(id, length);
+    }
+    if (id == SWITCH_ID) {
+        metrics.switch_time += length;
+    }
+    if (id <= 0) {
+        return;
+    }
+    metrics.cpu_busy += length;
+    if (process_metrics && metrics.processes[id - 1].first_run < 0) {
+        metrics.processes[id - 1].first_run = current_time - length + 1;
+    }
+    if (last_cpu_process[cpu] != 0 && last_cpu_process[cpu] != id) {
+        metrics.context_switches++;
+    }
+    last_cpu_process[cpu] = id;
+}
+
+// Record process `id` (0 = idle) on instance `resource` of R for the `length` time units ending
+// with the current one
+void Simulator::record_r(size_t resource, int id, long long length) {
+    if (gantt_writer != nullptr) {
+        gantt_writer->append_r(resource, id, length);
+    } else if (config.record_gantt) {
+        r_schedules[resource].append(id, length);
+    }
+    if (id == DISPATCH_ID) {
+        metrics.dispatch_time += length;
+    }
+    if (id > 0) {
+        metrics.r_busy += length;
+        if (!metrics.device_busy.empty()) {
+            metrics.device_busy[resource_device[resource]] += length;
+        }
+    }
+}
+
+// Process `id` finished its last burst in the current time unit
+void Simulator::complete(int id) {
+    completed++;
+    if (process_metrics) {
+        metrics.processes[id - 1].completion = current_time + 1;
+    }
+}
+
+// First-Come, First-Served (FCFS) scheduler
+void Simulator::fcfs_scheduler() {
+    std::queue<Process*> cpu_queue;
+    std::queue<Process*> io_queue;
+    Process* temp_cpu_process = nullptr;
+    ArrivalIndex arrivals(workload.arrival_times);
+
+    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
+        // Check for newly arrived processes
+        while (arrivals.arrives_at(current_time)) {
+            cpu_queue.push(&processes[arrivals.pop()]);
+        }
+
+        // Check any process remains after conflict in the entrance of the ready queue scenario
+        if (temp_cpu_process != nullptr){
+            cpu_queue.push(temp_cpu_process);
+            temp_cpu_process = nullptr;
+        }
+        // Handle CPU scheduling
+        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
+            current_cpu_process = cpu_queue.front();
+            cpu_queue.pop();
+        }
+
+        if (current_cpu_process != nullptr) {
+            record_cpu(0, current_cpu_process->id);
+            current_cpu_process->bursts[current_cpu_process->current_burst]--;
+
+            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
+                current_cpu_process->current_burst++;
+                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
+                    if (current_io_process == nullptr) {
+                        io_exec_flag = false;
+                    }
+                    io_queue.push(current_cpu_process);
+                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
+                    if (current_io_process == nullptr) {
+                        current_io_process = io_queue.front();
+                        io_queue.pop();
+                    }
+                } else {
+                    complete(current_cpu_process->id);
+                }
+                current_cpu_process = nullptr;
+            }
+        } else {
+            record_cpu(0, 0);
+        }
+
+        // Handle I/O scheduling
+        if (current_io_process == nullptr && !io_queue.empty()) {
+            current_io_process = io_queue.front();
+            io_queue.pop();
+        }
+
+        if (current_io_process != nullptr && io_exec_flag) {
+            record_r(0, current_io_process->id);
+            current_io_process->bursts[current_io_process->current_burst]--;
+
+            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
+                current_io_process->current_burst++;
+                if (current_io_process->current_burst < current_io_process->bursts.size()) {
+                    // Check if a new process will arrive in the next time unit
+                    if (arrivals.arrives_at(current_time + 1)) {
+                        temp_cpu_process = current_io_process;
+                    } else {
+                        cpu_queue.push(current_io_process);
+                    }
+                } else {
+                    complete(current_io_process->id);
+                }
+                
+                if (!io_queue.empty()) {
+                    current_io_process = io_queue.front();
+                    io_queue.pop();
+                } else {
+                    current_io_process = nullptr;
+                }
+            }
+        } else {
+            record_r(0, 0);
+        }
+
+        current_time++;
+        io_exec_flag = true;
+    }
+}
+
+// Round Robin (RR) scheduler
+void Simulator::rr_scheduler(int quantum) {
+    std::deque<Process*> cpu_queue;
+    std::queue<Process*> io_queue;
+    int time_in_quantum = 0;
+    Process* temp_cpu_process = nullptr;
+    std::vector<Process*> new_processes;
+    ArrivalIndex arrivals(workload.arrival_times);
+
+    auto compare_rr = [this](Process* a, Process* b) {
+        if (a->arrival_time == current_time && b->arrival_time != current_time)
+            return true; // a has higher priority
+        if (b->arrival_time == current_time && a->arrival_time != current_time)
+            return false; // b has higher priority
+        if (a->just_from_io && !b->just_from_io)
+            return true; // a just moved from I/O, higher priority
+        if (b->just_from_io && !a->just_from_io)
+            return false; // b just moved from I/O, higher priority
+        return a->id < b->id; // If all else is equal, choose the process with lower ID
+    };
+
+    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
+        // Check for newly arrived processes
+        while (arrivals.arrives_at(current_time)) {
+            new_processes.push_back(&processes[arrivals.pop()]);
+        }
+
+        // Sort new processes according to priority
+        std::sort(new_processes.begin(), new_processes.end(), compare_rr);
+
+        // Add sorted new processes to the end of the queue
+        for (auto* process : new_processes) {
+            cpu_queue.push_back(process);
+        }
+        new_processes.clear();
+
+        // Handle CPU scheduling
+        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
+            current_cpu_process = cpu_queue.front();
+            cpu_queue.pop_front();
+            time_in_quantum = 0;
+            current_cpu_process->just_from_io = false; // Reset the flag when process starts CPU burst
+        }
+
+        if (current_cpu_process != nullptr) {
+            record_cpu(0, current_cpu_process->id);
+            current_cpu_process->bursts[current_cpu_process->current_burst]--;
+            time_in_quantum++;
+
+            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
+                current_cpu_process->current_burst++;
+                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
+                    if (current_io_process == nullptr) {
+                        io_exec_flag = false;
+                    }
+                    io_queue.push(current_cpu_process);
+                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
+                    if (current_io_process == nullptr) {
+                        current_io_process = io_queue.front();
+                        io_queue.pop();
+                    }
+                } else {
+                    complete(current_cpu_process->id);
+                }
+                current_cpu_process = nullptr;
+                time_in_quantum = 0;
+            } else if (time_in_quantum == quantum) {
+                new_processes.push_back(current_cpu_process);
+                current_cpu_process = nullptr;
+                time_in_quantum = 0;
+            }
+        } else {
+            record_cpu(0, 0);
+        }
+
+        // Handle I/O scheduling
+        if (current_io_process == nullptr && !io_queue.empty()) {
+            current_io_process = io_queue.front();
+            io_queue.pop();
+        }
+
+        if (current_io_process != nullptr && io_exec_flag) {
+            record_r(0, current_io_process->id);
+            current_io_process->bursts[current_io_process->current_burst]--;
+
+            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
+                current_io_process->current_burst++;
+                if (current_io_process->current_burst < current_io_process->bursts.size()) {
+                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
+                    new_processes.push_back(current_io_process);
+                } else {
+                    complete(current_io_process->id);
+                }
+                
+                if (!io_queue.empty()) {
+                    current_io_process = io_queue.front();
+                    io_queue.pop();
+                } else {
+                    current_io_process = nullptr;
+                }
+            }
+        } else {
+            record_r(0, 0);
+        }
+
+        current_time++;
+        io_exec_flag = true;
+    }
+}
+
+// Shortest Job First (SJF) scheduler
+void Simulator::sjf_scheduler() {
+    std::vector<Process*> cpu_queue;
+    std::queue<Process*> io_queue;
+    ArrivalIndex arrivals(workload.arrival_times);
+
+    auto compare_sjf = [this](Process* a, Process* b) {
+        if (a->bursts[a->current_burst] == b->bursts[b->current_burst]) {
+            // If burst times are equal, use the new priority system
+            if (a->arrival_time == current_time && b->arrival_time != current_time)
+                return false; // a has higher priority
+            if (b->arrival_time == current_time && a->arrival_time != current_time)
+                return true; // b has higher priority
+            if (a->just_from_io && !b->just_from_io)
+                return false; // a just moved from I/O, higher priority
+            if (b->just_from_io && !a->just_from_io)
+                return true; // b just moved from I/O, higher priority
+            return a->id > b->id; // If all else is equal, choose the process with lower ID
+        }
+        return a->bursts[a->current_burst] > b->bursts[b->current_burst];
+    };
+
+    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
+        // Check for newly arrived processes
+        while (arrivals.arrives_at(current_time)) {
+            cpu_queue.push_back(&processes[arrivals.pop()]);
+            std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
+        }
+
+        // Handle CPU scheduling
+        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
+            std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
+            current_cpu_process = cpu_queue.back();
+            cpu_queue.pop_back();
+            current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
+        }
+
+        if (current_cpu_process != nullptr) {
+            record_cpu(0, current_cpu_process->id);
+            current_cpu_process->bursts[current_cpu_process->current_burst]--;
+
+            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
+                current_cpu_process->current_burst++;
+                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
+                    if (current_io_process == nullptr) {
+                        io_exec_flag = false;
+                    }
+                    io_queue.push(current_cpu_process);
+                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
+                    if (current_io_process == nullptr) {
+                        current_io_process = io_queue.front();
+                        io_queue.pop();
+                    }
+                } else {
+                    complete(current_cpu_process->id);
+                }
+                current_cpu_process = nullptr;
+            }
+        } else {
+            record_cpu(0, 0);
+        }
+
+        // Handle I/O scheduling (FCFS)
+        if (current_io_process == nullptr && !io_queue.empty()) {
+            current_io_process = io_queue.front();
+            io_queue.pop();
+        }
+
+        if (current_io_process != nullptr && io_exec_flag) {
+            record_r(0, current_io_process->id);
+            current_io_process->bursts[current_io_process->current_burst]--;
+
+            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
+                current_io_process->current_burst++;
+                if (current_io_process->current_burst < current_io_process->bursts.size()) {
+                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
+                    cpu_queue.push_back(current_io_process);
+                    std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
+                } else {
+                    complete(current_io_process->id);
+                }
+                
+                if (!io_queue.empty()) {
+                    current_io_process = io_queue.front();
+                    io_queue.pop();
+                } else {
+                    current_io_process = nullptr;
+                }
+            }
+        } else {
+            record_r(0, 0);
+        }
+
+        current_time++;
+        io_exec_flag = true;
+    }
+}
+
+// Shortest Remaining Time Next (SRTN) scheduler
+void Simulator::srtn_scheduler() {
+    std::vector<Process*> cpu_queue;
+    std::queue<Process*> io_queue;
+    ArrivalIndex arrivals(workload.arrival_times);
+
+    auto compare_srtn = [this](Process* a, Process* b) {
+        if (a->remaining_time == b->remaining_time) {
+            if (a->arrival_time == current_time && b->arrival_time != current_time)
+                return false; // a has higher priority
+            if (b->arrival_time == current_time && a->arrival_time != current_time)
+                return true; // b has higher priority
+            if (a->just_from_io && !b->just_from_io)
+                return false; // a just moved from I/O, higher priority
+            if (b->just_from_io && !a->just_from_io)
+                return true; // b just moved from I/O, higher priority
+            return a->id > b->id; // If all else is equal, choose the process with lower ID
+        }
+        return a->remaining_time > b->remaining_time; // Shorter remaining time has higher priority
+    };
+
+    // Initialize remaining time for all processes
+    for (auto& process : processes) {
+        process.remaining_time = process.bursts[0];
+    }
+
+    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
+        // Check for newly arrived processes
+        while (arrivals.arrives_at(current_time)) {
+            cpu_queue.push_back(&processes[arrivals.pop()]);
+            std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
+        }
+
+        // Handle CPU scheduling
+        if (!cpu_queue.empty()) {
+            Process* shortest_process = cpu_queue.front(); // The shortest process is at the front of the heap
+            
+            if (current_cpu_process == nullptr) {
+                std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
+                current_cpu_process = cpu_queue.back();
+                cpu_queue.pop_back();
+                current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
+            } else if (shortest_process->remaining_time < current_cpu_process->remaining_time) {
+                cpu_queue.push_back(current_cpu_process);
+                std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
+                std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
+                current_cpu_process = cpu_queue.back();
+                cpu_queue.pop_back();
+                current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
+            }
+        }
+
+        if (current_cpu_process != nullptr) {
+            record_cpu(0, current_cpu_process->id);
+            current_cpu_process->bursts[current_cpu_process->current_burst]--;
+            current_cpu_process->remaining_time--;
+
+            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
+                current_cpu_process->current_burst++;
+                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
+                    if (current_io_process == nullptr) {
+                        io_exec_flag = false;
+                    }
+                    io_queue.push(current_cpu_process);
                     // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
                     if (current_io_process == nullptr) {
                         current_io_process = io_queue.front();
                         io_queue.pop();
                     }
+                    current_cpu_process->remaining_time = current_cpu_process->bursts[current_cpu_process->current_burst];
+                } else {
+                    complete(current_cpu_process->id);
+                }
+                current_cpu_process = nullptr;
+            }
+        } else {
+            record_cpu(0, 0);
+        }
+
+        // Handle I/O scheduling (FCFS)
+        if (current_io_process == nullptr && !io_queue.empty()) {
+            current_io_process = io_queue.front();
+            io_queue.pop();
+        }
+
+        if (current_io_process != nullptr && io_exec_flag) {
+            record_r(0, current_io_process->id);
+            current_io_process->bursts[current_io_process->current_burst]--;
+
+            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
+                current_io_process->current_burst++;
+                if (current_io_process->current_burst < current_io_process->bursts.size()) {
+                    current_io_process->remaining_time = current_io_process->bursts[current_io_process->current_burst];
+                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
+                    cpu_queue.push_back(current_io_process);
+                    std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
+                } else {
+                    complete(current_io_process->id);
+                }
+                
+                if (!io_queue.empty()) {
+                    current_io_process = io_queue.front();
+                    io_queue.pop();
+                } else {
+                    current_io_process = nullptr;
+                }
+            }
+        } else {
+            record_r(0, 0);
+        }
+
+        current_time++;
+        io_exec_flag = true;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Event-driven engine
+//
+// The schedulers above advance one time unit per loop iteration. The engine below follows the
+// exact same rules, but after each scheduling decision it jumps straight to the next event
+// (arrival, burst completion, time slice expiry) instead of ticking through the time units in
+// between, where nothing but the running bursts changes. With one CPU and one resource R the
+// Gantt output is identical to the tick-based schedulers.
+//
+// It also simulates several CPUs and several instances of resource R. When several of them act
+// in the same time unit they are visited in index order. The R instances are grouped into device
+// classes, each with its own DeviceQueue; by default there is one FCFS class.
+// The CPUs share one ready queue, or with per-core queues each CPU has its own: arrivals go to
+// the shortest queue, a process returns to the queue of the CPU it last ran on, and an idle CPU
+// with an empty queue steals the next process of the longest other queue.
+//
+// Processes are 32-bit slots in the ProcessTable rather than copies of the workload, so a run
+// allocates a few dense arrays instead of one burst vector per process. Streamed runs take the
+// processes from the input as they arrive and release them when they complete.
+//
+// The engine is a template on the ready queue and the arrival source, so every algorithm gets
+// its own copy of the loop with the queue operations inlined. A new policy only has to supply a
+// ready queue; the CPU, R and arrival handling are shared by all of them.
+// ---------------------------------------------------------------------------------------------
+
+template <typename Queue, typename Arrivals>
+class EventEngine {
+public:
+    EventEngine(Simulator& simulator, Arrivals& arrivals, const Workload* workload)
+        : simulator(simulator), config(simulator.config), current_time(simulator.current_time), arrivals(arrivals) {
+        table.initial_estimate = config.predict_bursts ? config.initial_estimate : -1;
+        table.reset(workload);
+        cpus.assign(config.cpus, CpuState());
+        resources.assign(config.resources, ResourceState());
+        std::vector<DeviceConfig> devices = config.device_classes();
+        for (const auto& device : devices) {
+            device_queues.emplace_back(device.policy);
+        }
+        for (size_t r = 0; r < resources.size(); r++) {
+            resources[r].device = simulator.resource_device[r];
+            if (devices[resources[r].device].policy == DevicePolicy::RoundRobin && config.quantum > 0) {
+                resources[r].time_slice = config.quantum;
+            }
+        }
+        int queue_count = config.per_core_queues ? config.cpus : 1;
+        ready_queues.reserve(queue_count);
+        for (int q = 0; q < queue_count; q++) {
+            ready_queues.emplace_back(current_time, table, config);
+        }
+    }
+
+    void run() {
+        bool checkpoints = !config.checkpoint_file.empty();
+        if (config.resume) {
+            restore();
+        }
+        auto last_checkpoint = std::chrono::steady_clock::now();
+        uint32_t iterations = 0;
+        while (simulator.completed < admitted || arrivals.pending()) {
+            PROFILE(profile().steps++);
+            // Look at the clock only every so many events
+            if (checkpoints && ++iterations % CHECKPOINT_POLL == 0) {
+                auto now = std::chrono::steady_clock::now();
+                if (std::chrono::duration<double>(now - last_checkpoint).count() >= config.checkpoint_interval) {
+                    checkpoint();
+                    last_checkpoint = now;
+                }
+            }
+
+            while (arrivals.arrives_at(current_time)) {
+                uint32_t process = arrivals.admit(table);
+                admitted++;
+                size_t shortest = 0;
+                for (size_t q = 1; q < ready_queues.size(); q++) {
+                    if (ready_queues[q].size() < ready_queues[shortest].size()) {
+                        shortest = q;
+                    }
+                }
+                table.home_queue[process] = static_cast<uint32_t>(shortest);
+                ready_queues[shortest].arrive(process);
+                PROFILE(profile().ready_queue_pushes++);
+            }
+            for (auto& queue : ready_queues) {
+                queue.arrivals_done();
+            }
+            PROFILE(note_queue_lengths());
+
+            dispatch();
+
+            long long step = next_event_step();
+            // Completions below happen in the last time unit of the step
+            current_time += step - 1;
+            for (size_t c = 0; c < cpus.size(); c++) {
+                run_cpu_step(c, step);
+            }
+            for (size_t r = 0; r < resources.size(); r++) {
+                run_io_step(r, step);
+            }
+
+            current_time++;
+            for (auto& resource : resources) {
+                resource.exec = true;
+            }
+        }
+    }
+
+private:
+    struct CpuState {
+        uint32_t process = NO_PROCESS;
+        long long time_in_quantum = 0;
+        long long time_slice = NO_TIME_SLICE;
+        long long switching = 0;  // Time left switching to `process` before it runs
+    };
+    struct ResourceState {
+        uint32_t process = NO_PROCESS;
+        bool exec = true;  // False in the time unit the process was handed over from the CPU
+        uint32_t device = 0;  // Device class
+        long long time_in_quantum = 0;
+        long long time_slice = NO_TIME_SLICE;  // Round robin device classes only
+        long long dispatching = 0;  // Time left dispatching `process` before its burst runs
+    };
+
+    Simulator& simulator;
+    const SimulationConfig& config;
+    long long& current_time;
+    Arrivals& arrivals;
+    ProcessTable table;
+    std::vector<CpuState> cpus;
+    std::vector<ResourceState> resources;
+    std::vector<Queue> ready_queues;
+    std::vector<DeviceQueue> device_queues;  // One per device class
+    size_t admitted = 0;
+
+    static const uint32_t CHECKPOINT_POLL = 1024;
+
+#ifdef SCHEDULER_PROFILE
+    Profile& profile() { return simulator.profile; }
+
+    // Update the high-water marks, after the arrivals and I/O returns of a time unit are queued
+    void note_queue_lengths() {
+        size_t ready = 0;
+        for (const auto& queue : ready_queues) {
+            ready += queue.size();
+        }
+        size_t waiting = 0;
+        for (const auto& queue : device_queues) {
+            waiting += queue.size();
+        }
+        profile().ready_queue_max = std::max(profile().ready_queue_max, ready);
+        profile().io_queue_max = std::max(profile().io_queue_max, waiting);
+    }
+#endif
+
+    // Save the whole state of the run, at the start of a loop iteration, to the checkpoint file
+    void checkpoint() {
+        PROFILE(profile().checkpoints++);
+        SnapshotWriter snapshot;
+        for (const auto& field : identity()) {
+            snapshot.put(field.first);
+        }
+        snapshot.put_signed(current_time);
+        snapshot.put(simulator.completed);
+        snapshot.put_values(simulator.last_cpu_process);
+        const Metrics& metrics = simulator.metrics;
+        snapshot.put_signed(metrics.cpu_busy);
+        snapshot.put_signed(metrics.r_busy);
+        snapshot.put_signed(metrics.context_switches);
+        snapshot.put_values(metrics.device_busy);
+        snapshot.put_signed(metrics.switch_time);
+        snapshot.put_signed(metrics.dispatches);
+        snapshot.put_signed(metrics.dispatch_time);
+        snapshot.put_signed(metrics.predicted_bursts);
+        snapshot.put_double(metrics.prediction_error);
+        snapshot.put_double(metrics.prediction_bias);
+        for (const auto& process : metrics.processes) {
+            snapshot.put_signed(process.first_run);
+            snapshot.put_signed(process.completion);
+        }
+        for (const auto* schedules : {&simulator.cpu_schedules, &simulator.r_schedules}) {
+            for (const Timeline& timeline : *schedules) {
+                snapshot.put(timeline.intervals.size());
+                for (const auto& interval : timeline.intervals) {
+                    snapshot.put_signed(interval.id);
+                    snapshot.put_signed(interval.length);
+                }
+            }
+        }
+
+        snapshot.put_values(table.remaining);
+        snapshot.put_values(table.current_burst);
+        snapshot.put_values(table.just_from_io);
+        snapshot.put_values(table.home_queue);
+        snapshot.put_values(table.estimate);
+        for (const auto& cpu : cpus) {
+            snapshot.put(cpu.process);
+            snapshot.put_signed(cpu.time_in_quantum);
+            snapshot.put_signed(cpu.time_slice);
+            snapshot.put_signed(cpu.switching);
+        }
+        for (const auto& resource : resources) {
+            snapshot.put(resource.process);
+            snapshot.put(resource.exec);
+            snapshot.put_signed(resource.time_in_quantum);
+            snapshot.put_signed(resource.dispatching);
+        }
+        for (const auto& queue : ready_queues) {
+            queue.save(snapshot);
+        }
+        for (const auto& queue : device_queues) {
+            queue.save(snapshot);
+        }
+        snapshot.put(admitted);
+        arrivals.save(snapshot);
+
+        // The checkpoint may only refer to output that has reached the files
+        if (simulator.gantt_writer != nullptr) {
+            simulator.gantt_writer->save(snapshot);
+        }
+        snapshot.save(config.checkpoint_file);
+    }
+
+    // Load what checkpoint() saved, after checking that it was saved by the same kind of run
+    void restore() {
+        SnapshotReader snapshot(config.checkpoint_file);
+        for (const auto& field : identity()) {
+            snapshot.expect(field.first, field.second);
+        }
+        current_time = snapshot.get_signed();
+        simulator.completed = snapshot.get();
+        snapshot.get_values(simulator.last_cpu_process);
+        Metrics& metrics = simulator.metrics;
+        metrics.cpu_busy = snapshot.get_signed();
+        metrics.r_busy = snapshot.get_signed();
+        metrics.context_switches = snapshot.get_signed();
+        snapshot.get_values(metrics.device_busy);
+        metrics.switch_time = snapshot.get_signed();
+        metrics.dispatches = snapshot.get_signed();
+        metrics.dispatch_time = snapshot.get_signed();
+        metrics.predicted_bursts = snapshot.get_signed();
+        metrics.prediction_error = snapshot.get_double();
+        metrics.prediction_bias = snapshot.get_double();
+        for (auto& process : metrics.processes) {
+            process.first_run = snapshot.get_signed();
+            process.completion = snapshot.get_signed();
+        }
+        for (auto* schedules : {&simulator.cpu_schedules, &simulator.r_schedules}) {
+            for (Timeline& timeline : *schedules) {
+                timeline.intervals.clear();
+                for (uint64_t count = snapshot.get(); count > 0; count--) {
+                    int id = static_cast<int>(snapshot.get_signed());
+                    timeline.append(id, snapshot.get_signed());
+                }
+            }
+        }
+
+        snapshot.get_values(table.remaining);
+        snapshot.get_values(table.current_burst);
+        snapshot.get_values(table.just_from_io);
+        snapshot.get_values(table.home_queue);
+        snapshot.get_values(table.estimate);
+        for (auto& cpu : cpus) {
+            cpu.process = static_cast<uint32_t>(snapshot.get());
+            cpu.time_in_quantum = snapshot.get_signed();
+            cpu.time_slice = snapshot.get_signed();
+            cpu.switching = snapshot.get_signed();
+        }
+        for (auto& resource : resources) {
+            resource.process = static_cast<uint32_t>(snapshot.get());
+            resource.exec = snapshot.get() != 0;
+            resource.time_in_quantum = snapshot.get_signed();
+            resource.dispatching = snapshot.get_signed();
+        }
+        for (auto& queue : ready_queues) {
+            queue.restore(snapshot);
+        }
+        for (auto& queue : device_queues) {
+            queue.restore(snapshot);
+        }
+        admitted = snapshot.get();
+        arrivals.restore(snapshot);
+
+        if (simulator.gantt_writer != nullptr) {
+            simulator.gantt_writer->restore(snapshot);
+        }
+    }
+
+    // What a checkpoint records about its run, and a resumed run must agree on
+    std::vector<std::pair<uint64_t, const char*>> identity() const {
+        const Workload& workload = simulator.workload;
+        // FNV-1a over the input
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const auto& values) {
+            for (auto value : values) {
+                hash = (hash ^ static_cast<uint32_t>(value)) * 1099511628211ull;
+            }
+        };
+        mix(workload.arrival_times);
+        mix(workload.bursts);
+        mix(workload.weights);
+        mix(workload.devices);
+        uint64_t device_hash = 0;
+        for (const auto& device : config.devices) {
+            device_hash = (device_hash * 31 + static_cast<uint64_t>(device.policy)) * 1000003 + device.instances;
+        }
+        auto bits = [](double value) {
+            uint64_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        };
+        return {
+            {hash, "input"},
+            {workload.size(), "input"},
+            {static_cast<uint64_t>(config.algorithm), "algorithm"},
+            {static_cast<uint64_t>(config.quantum), "quantum"},
+            {static_cast<uint64_t>(config.mlfq_levels), "number of MLFQ levels"},
+            {static_cast<uint64_t>(config.mlfq_boost), "MLFQ boost"},
+            {static_cast<uint64_t>(config.aging), "aging"},
+            {config.seed, "seed"},
+            {static_cast<uint64_t>(config.cpus), "number of CPUs"},
+            {static_cast<uint64_t>(config.resources), "number of R instances"},
+            {device_hash, "device classes"},
+            {static_cast<uint64_t>(config.switch_cost), "context switch cost"},
+            {static_cast<uint64_t>(config.dispatch_latency), "dispatch latency"},
+            {config.per_core_queues, "queue layout"},
+            {config.predict_bursts, "burst prediction"},
+            {bits(config.alpha), "prediction weight"},
+            {bits(config.initial_estimate), "initial estimate"},
+            {config.packed_heap, "ready heap"},
+            {config.record_gantt, "Gantt chart setting"},
+            {simulator.gantt_writer != nullptr, "Gantt chart setting"},
+        };
+    }
+
+    // Ready queue a process enters (or returns to)
+    Queue& queue_of(uint32_t process) {
+        return ready_queues[table.home_queue[process]];
+    }
+
+    // Start running `process` on `cpu`
+    void start_on_cpu(size_t cpu, uint32_t process) {
+        PROFILE(profile().ready_queue_pops++);
+        int last = simulator.last_cpu_process[cpu];
+        cpus[cpu].switching = last != 0 && last != table.id(process) ? config.switch_cost : 0;
+        cpus[cpu].process = process;
+        cpus[cpu].time_in_quantum = 0;
+        table.just_from_io[process] = 0;  // Reset the flag when process starts CPU burst
+        if (config.per_core_queues) {
+            table.home_queue[process] = static_cast<uint32_t>(cpu);
+        }
+        cpus[cpu].time_slice = queue_of(process).time_slice(process);
+    }
+
+    // Give idle CPUs the next ready process and let the queue preempt running ones
+    void dispatch() {
+        for (size_t c = 0; c < cpus.size(); c++) {
+            Queue& queue = ready_queues[config.per_core_queues ? c : 0];
+            if (cpus[c].process == NO_PROCESS && !queue.empty()) {
+                start_on_cpu(c, queue.pop());
+            }
+        }
+
+        if (config.per_core_queues) {
+            for (size_t c = 0; c < cpus.size(); c++) {
+                if (cpus[c].process != NO_PROCESS) {
+                    continue;
+                }
+                size_t victim = c;
+                for (size_t q = 0; q < ready_queues.size(); q++) {
+                    if (ready_queues[q].size() > ready_queues[victim].size()) {
+                        victim = q;
+                    }
+                }
+                if (!ready_queues[victim].empty()) {
+                    PROFILE(profile().steals++);
+                    start_on_cpu(c, ready_queues[victim].pop());
+                }
+            }
+
+            for (size_t c = 0; c < cpus.size(); c++) {
+                if (cpus[c].process == NO_PROCESS) {
+                    continue;
+                }
+                uint32_t replacement = ready_queues[c].preempt_running(cpus[c].process);
+                if (replacement != NO_PROCESS) {
+                    PROFILE(profile().preemptions++; profile().ready_queue_pushes++);
+                    start_on_cpu(c, replacement);
+                }
+            }
+            return;
+        }
+
+        // Shared queue: the queue picks the running process to preempt first (for SRTN the one
+        // with the most time remaining)
+        Queue& queue = ready_queues[0];
+        while (true) {
+            size_t victim = cpus.size();
+            for (size_t c = 0; c < cpus.size(); c++) {
+                uint32_t running = cpus[c].process;
+                if (running != NO_PROCESS && (victim == cpus.size() || queue.preempt_before(running, cpus[victim].process))) {
+                    victim = c;
+                }
+            }
+            if (victim == cpus.size()) {
+                return;
+            }
+            uint32_t replacement = queue.preempt_running(cpus[victim].process);
+            if (replacement == NO_PROCESS) {
+                return;
+            }
+            PROFILE(profile().preemptions++; profile().ready_queue_pushes++);
+            start_on_cpu(victim, replacement);
+        }
+    }
+
+    // Number of time units until the next event: a running CPU or R burst completes, a time
+    // slice expires or the next process arrives
+    long long next_event_step() {
+        long long step = std::numeric_limits<long long>::max();
+        for (const auto& cpu : cpus) {
+            if (cpu.process != NO_PROCESS && cpu.switching > 0) {
+                step = std::min(step, cpu.switching);
+            } else if (cpu.process != NO_PROCESS) {
+                step = std::min<long long>(step, table.remaining[cpu.process]);
+                step = std::min(step, cpu.time_slice - cpu.time_in_quantum);
+            }
+        }
+        for (const auto& resource : resources) {
+            if (resource.process != NO_PROCESS && resource.exec && resource.dispatching > 0) {
+                step = std::min(step, resource.dispatching);
+            } else if (resource.process != NO_PROCESS && resource.exec) {
+                step = std::min<long long>(step, table.remaining[resource.process]);
+                step = std::min(step, resource.time_slice - resource.time_in_quantum);
+            }
+        }
+        if (arrivals.pending()) {
+            step = std::min(step, arrivals.next_time() - current_time);
+        }
+        if (step == std::numeric_limits<long long>::max()) {
+            throw std::logic_error("Simulation stalled at time " + std::to_string(current_time));
+        }
+        return step;
+    }
+
+    // Move `process` to its next burst. Returns false if it has finished its last one.
+    bool next_burst(uint32_t process) {
+        uint32_t burst = ++table.current_burst[process];
+        if (burst >= table.burst_count(process)) {
+            return false;
+        }
+        table.remaining[process] = table.burst(process, burst);
+        return true;
+    }
+
+    // Exponential average: the CPU burst of `process` that just completed updates the estimate
+    // of its next one, tau' = alpha * t + (1 - alpha) * tau
+    void predict(uint32_t process) {
+        int actual = table.burst(process, table.current_burst[process]);
+        double& estimate = table.estimate[process];
+        Metrics& metrics = simulator.metrics;
+        metrics.predicted_bursts++;
+        metrics.prediction_error += std::abs(estimate - actual);
+        metrics.prediction_bias += estimate - actual;
+        estimate = config.alpha * actual + (1 - config.alpha) * estimate;
+    }
+
+    // `process` finished its last burst in the current time unit, its slot may be reused
+    void retire(uint32_t process) {
+        simulator.complete(table.id(process));
+        arrivals.release(table, process);
+    }
+
+    // Run `cpu` for `step` time units. A process whose CPU burst completes is handed over to
+    // resource R (or counted as completed); one whose time slice expires goes back to its ready
+    // queue.
+    void run_cpu_step(size_t cpu, long long step) {
+        CpuState& state = cpus[cpu];
+        uint32_t process = state.process;
+        if (process != NO_PROCESS && state.switching > 0) {
+            simulator.record_cpu(cpu, SWITCH_ID, step);
+            state.switching -= step;
+            return;
+        }
+        simulator.record_cpu(cpu, process == NO_PROCESS ? 0 : table.id(process), step);
+        if (process == NO_PROCESS) {
+            return;
+        }
+
+        table.remaining[process] -= static_cast<int>(step);
+        state.time_in_quantum += step;
+
+        if (table.remaining[process] == 0) {
+            if (!table.estimate.empty()) {
+                predict(process);
+            }
+            if (next_burst(process)) {
+                enter_device(process);
+            } else {
+                retire(process);
+            }
+            state.process = NO_PROCESS;
+        } else if (state.time_in_quantum == state.time_slice) {
+            PROFILE(profile().quantum_expirations++; profile().ready_queue_pushes++);
+            queue_of(process).preempt(process);
+            state.process = NO_PROCESS;
+        }
+    }
+
+    // `process` finished its CPU burst in the current time unit and queues for the device
+    // class of its next burst. An idle instance of the class takes the next queued process,
+    // which starts in the next time unit.
+    void enter_device(uint32_t process) {
+        uint32_t device = static_cast<uint32_t>(table.device(process, table.current_burst[process]));
+        if (device >= device_queues.size()) {
+            throw std::runtime_error("Process " + std::to_string(table.id(process)) + " uses device class " + std::to_string(device) + ", which --devices does not define");
+        }
+        DeviceQueue& queue = device_queues[device];
+        queue.push(process, table.remaining[process], table.id(process));
+        PROFILE(profile().io_queue_pushes++; note_queue_lengths());
+        for (auto& resource : resources) {
+            if (resource.device == device && resource.process == NO_PROCESS) {
+                take(resource, queue.pop());
+                resource.exec = false;
+                break;
+            }
+        }
+    }
+
+    // Give `process` to an R instance, or leave it idle for NO_PROCESS
+    void take(ResourceState& state, uint32_t process) {
+        state.process = process;
+        state.time_in_quantum = 0;
+        state.dispatching = 0;
+        if (process != NO_PROCESS && config.dispatch_latency > 0) {
+            state.dispatching = config.dispatch_latency;
+            simulator.metrics.dispatches++;
+        }
+    }
+
+    // Run instance `resource` of R for `step` time units. A process whose R burst completes
+    // goes back to its ready queue (or is counted as completed), one whose time slice expires
+    // goes back to the device queue, and the next queued process takes over.
+    void run_io_step(size_t resource, long long step) {
+        ResourceState& state = resources[resource];
+        DeviceQueue& queue = device_queues[state.device];
+        if (state.process == NO_PROCESS && !queue.empty()) {
+            take(state, queue.pop());
+        }
+
+        uint32_t process = state.process;
+        if (process == NO_PROCESS || !state.exec) {
+            simulator.record_r(resource, 0, step);
+            return;
+        }
+        if (state.dispatching > 0) {
+            simulator.record_r(resource, DISPATCH_ID, step);
+            state.dispatching -= step;
+            return;
+        }
+
+        simulator.record_r(resource, table.id(process), step);
+        table.remaining[process] -= static_cast<int>(step);
+        state.time_in_quantum += step;
+        if (table.remaining[process] != 0) {
+            if (state.time_in_quantum == state.time_slice) {
+                queue.push(process, table.remaining[process], table.id(process));
+                uint32_t next = queue.pop();
+                if (next == process) {
+                    // Nothing else is queued: the process keeps the instance without a new dispatch
+                    state.time_in_quantum = 0;
                 } else {
-                    completed++;
+                    take(state, next);
                 }
-                current_cpu_process = nullptr;
-                time_in_quantum = 0;
-            } else if (time_in_quantum == quantum) {
-                new_processes.push_back(current_cpu_process);
-                current_cpu_process = nullptr;
-                time_in_quantum = 0;
             }
+            return;
+        }
+
+        if (next_burst(process)) {
+            table.just_from_io[process] = 1;  // Set the flag when process finishes I/O burst
+            queue_of(process).return_from_io(process);
+            PROFILE(profile().ready_queue_pushes++);
         } else {
-            cpu_schedule.push_back(0);
+            retire(process);
         }
 
-        // Handle I/O scheduling
-        if (current_io_process == nullptr && !io_queue.empty()) {
-            current_io_process = io_queue.front();
-            io_queue.pop();
+        take(state, queue.empty() ? NO_PROCESS : queue.pop());
+    }
+};
+
+// Run the engine instantiated for the configured algorithm
+template <typename Arrivals>
+void Simulator::event_scheduler(Arrivals& arrivals, const Workload* in_memory) {
+    switch (config.algorithm) {
+        case 1:
+            EventEngine<FcfsQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        case 2:
+            EventEngine<RoundRobinQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        case 3:
+            if (config.predict_bursts) {
+                EventEngine<ShortestFirstQueue<false, true>, Arrivals>(*this, arrivals, in_memory).run();
+            } else if (config.packed_heap) {
+                EventEngine<PackedShortestFirstQueue<false>, Arrivals>(*this, arrivals, in_memory).run();
+            } else {
+                EventEngine<ShortestFirstQueue<false, false>, Arrivals>(*this, arrivals, in_memory).run();
+            }
+            break;
+        case 4:
+            if (config.predict_bursts) {
+                EventEngine<ShortestFirstQueue<true, true>, Arrivals>(*this, arrivals, in_memory).run();
+            } else if (config.packed_heap) {
+                EventEngine<PackedShortestFirstQueue<true>, Arrivals>(*this, arrivals, in_memory).run();
+            } else {
+                EventEngine<ShortestFirstQueue<true, false>, Arrivals>(*this, arrivals, in_memory).run();
+            }
+            break;
+        case 5:
+            EventEngine<MultilevelFeedbackQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        case 6:
+            EventEngine<PriorityAgingQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        case 7:
+            EventEngine<LotteryQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        case 8:
+            EventEngine<StrideQueue, Arrivals>(*this, arrivals, in_memory).run();
+            break;
+        default:
+            throw std::runtime_error("Invalid algorithm specified");
+    }
+}
+
+// Value at percentile `p` (nearest rank) of `values`, which is sorted in place
+long long percentile(std::vector<long long>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[rank == 0 ? 0 : rank - 1];
+}
+
+// Mean, p50 and p99 of one per-process time
+void write_distribution(std::ostream& out, const std::string& name, std::vector<long long> values) {
+    double sum = 0;
+    for (long long value : values) {
+        sum += value;
+    }
+    out << name << "_mean " << (values.empty() ? 0.0 : sum / values.size()) << "\n";
+    out << name << "_p50 " << percentile(values, 50) << "\n";
+    out << name << "_p99 " << percentile(values, 99) << "\n";
+}
+
+// Per-process times followed by the aggregate metrics, one `name value` pair per line
+void write_metrics(std::ostream& out, const Metrics& metrics) {
+    std::vector<long long> turnaround, waiting, response;
+    out << "id arrival first_run completion turnaround waiting response\n";
+    for (const auto& process : metrics.processes) {
+        out << process.id << ' ' << process.arrival_time << ' ' << process.first_run << ' ' << process.completion << ' '
+            << process.turnaround() << ' ' << process.waiting() << ' ' << process.response() << "\n";
+        turnaround.push_back(process.turnaround());
+        waiting.push_back(process.waiting());
+        response.push_back(process.response());
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "makespan " << metrics.makespan << "\n";
+    out << "cpu_utilization " << metrics.cpu_utilization() << "\n";
+    out << "r_utilization " << metrics.r_utilization() << "\n";
+    out << "context_switches " << metrics.context_switches << "\n";
+    if (metrics.overhead) {
+        out << "switch_time " << metrics.switch_time << "\n";
+        out << "dispatches " << metrics.dispatches << "\n";
+        out << "dispatch_time " << metrics.dispatch_time << "\n";
+    }
+    for (size_t d = 0; d < metrics.device_busy.size(); d++) {
+        out << "device" << d << "_utilization " << metrics.device_utilization(d) << "\n";
+    }
+    if (metrics.predicted_bursts > 0) {
+        out << "predicted_bursts " << metrics.predicted_bursts << "\n";
+        out << "prediction_error_mean " << metrics.mean_prediction_error() << "\n";
+        out << "prediction_bias_mean " << metrics.mean_prediction_bias() << "\n";
+    }
+    write_distribution(out, "turnaround", turnaround);
+    write_distribution(out, "waiting", waiting);
+    write_distribution(out, "response", response);
+}
+
+// One line on how far the predicted CPU bursts were off, if any were predicted
+void write_prediction_summary(std::ostream& out, const Metrics& metrics) {
+    if (metrics.predicted_bursts == 0) {
+        return;
+    }
+    out << std::fixed << std::setprecision(3) << "Predicted " << metrics.predicted_bursts << " CPU bursts, mean absolute error "
+        << metrics.mean_prediction_error() << ", mean error " << metrics.mean_prediction_bias() << std::endl;
+    out.unsetf(std::ios::fixed);
+}
+
+// One line with the utilization of every device class, if there are device classes
+void write_device_summary(std::ostream& out, const Metrics& metrics) {
+    if (metrics.device_busy.empty()) {
+        return;
+    }
+    out << std::fixed << std::setprecision(3) << "Device utilization:";
+    for (size_t d = 0; d < metrics.device_busy.size(); d++) {
+        out << ' ' << d << '=' << metrics.device_utilization(d);
+    }
+    out << std::endl;
+    out.unsetf(std::ios::fixed);
+}
+
+void write_metrics_file(const std::string& filename, const Metrics& metrics) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening metrics file");
+    }
+    write_metrics(file, metrics);
+}
+
+// Run one simulation of `workload`, streaming the Gantt chart to `gantt_writer` if given
+SimulationResult simulate(const Workload& workload, const SimulationConfig& config, GanttWriter* gantt_writer = nullptr) {
+    return Simulator(workload, config, gantt_writer).run();
+}
+
+// Simulate the processes read from `input` while the simulation runs. Memory use depends on the
+// number of processes alive at the same time, not on the length of the input.
+SimulationResult simulate_stream(std::FILE* input, const SimulationConfig& config, GanttWriter* gantt_writer) {
+    Workload no_workload;
+    StreamArrivals arrivals(input);
+    return Simulator(no_workload, config, gantt_writer).run(&arrivals);
+}
+
+const char* algorithm_name(int algorithm) {
+    switch (algorithm) {
+        case 1: return "FCFS";
+        case 2: return "RR";
+        case 3: return "SJF";
+        case 4: return "SRTN";
+        case 5: return "MLFQ";
+        case 6: return "PRIO";
+        case 7: return "LOTTERY";
+        case 8: return "STRIDE";
+        default: return "?";
+    }
+}
+
+// Algorithms whose result depends on the quantum
+bool uses_quantum(int algorithm) {
+    return algorithm == 2 || algorithm == 5 || algorithm == 7 || algorithm == 8;
+}
+
+#ifdef SCHEDULER_PROFILE
+// Wall time of the phases of a single run, in seconds
+struct PhaseTimes {
+    double parse = 0;     // Reading the input file
+    double simulate = 0;  // Simulation, without the Gantt chart writes made during it
+    double write = 0;     // Gantt chart and metrics file
+};
+
+// JSON report of --profile
+void write_profile_file(const std::string& filename, const SimulationConfig& config, size_t processes, const PhaseTimes& phases, const SimulationResult& result) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening profile file");
+    }
+    const Profile& profile = result.profile;
+    file << std::fixed << std::setprecision(3)
+         << "{\n"
+         << "  \"version\": 1,\n"
+         << "  \"algorithm\": \"" << algorithm_name(config.algorithm) << "\",\n"
+         << "  \"quantum\": " << config.quantum << ",\n"
+         << "  \"engine\": \"" << (config.tick_engine ? "tick" : "event") << "\",\n"
+         << "  \"cpus\": " << config.cpus << ",\n"
+         << "  \"resources\": " << config.resources << ",\n"
+         << "  \"processes\": " << processes << ",\n"
+         << "  \"phases_ms\": {\n"
+         << "    \"parse\": " << phases.parse * 1000 << ",\n"
+         << "    \"simulate\": " << phases.simulate * 1000 << ",\n"
+         << "    \"write\": " << phases.write * 1000 << "\n"
+         << "  },\n"
+         << "  \"counters\": {\n"
+         << "    \"simulated_time\": " << result.metrics.makespan << ",\n"
+         << "    \"steps\": " << profile.steps << ",\n"
+         << "    \"context_switches\": " << result.metrics.context_switches << ",\n"
+         << "    \"preemptions\": " << profile.preemptions << ",\n"
+         << "    \"quantum_expirations\": " << profile.quantum_expirations << ",\n"
+         << "    \"steals\": " << profile.steals << ",\n"
+         << "    \"ready_queue_pushes\": " << profile.ready_queue_pushes << ",\n"
+         << "    \"ready_queue_pops\": " << profile.ready_queue_pops << ",\n"
+         << "    \"io_queue_pushes\": " << profile.io_queue_pushes << ",\n"
+         << "    \"checkpoints\": " << profile.checkpoints << "\n"
+         << "  },\n"
+         << "  \"high_water\": {\n"
+         << "    \"ready_queue\": " << profile.ready_queue_max << ",\n"
+         << "    \"io_queue\": " << profile.io_queue_max << "\n"
+         << "  }\n"
+         << "}\n";
+    if (!file) {
+        throw std::runtime_error("Error writing profile file");
+    }
+}
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// Parameter sweep: the workload is read once and every (algorithm, quantum) combination is
+// simulated in parallel, each on its own Simulator.
+// ---------------------------------------------------------------------------------------------
+
+struct SweepJob {
+    SimulationConfig config;
+    std::string output_file;
+    Metrics metrics;
+    double seconds = 0;
+    std::string error;  // Empty if the run succeeded
+};
+
+// `output_file` with `suffix` inserted before its extension, e.g. out.txt -> out_rr_q4.txt
+std::string output_file_with_suffix(const std::string& output_file, const std::string& suffix) {
+    size_t dot = output_file.find_last_of('.');
+    size_t slash = output_file.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return output_file + suffix;
+    }
+    return output_file.substr(0, dot) + suffix + output_file.substr(dot);
+}
+
+// One job per algorithm, the ones with a quantum once per quantum
+std::vector<SweepJob> make_sweep_jobs(const std::string& output_file, const std::vector<int>& algorithms, const std::vector<int>& quanta, const SimulationConfig& base) {
+    std::vector<SweepJob> jobs;
+    for (int algorithm : algorithms) {
+        std::vector<int> job_quanta = uses_quantum(algorithm) ? quanta : std::vector<int>{quanta.front()};
+        for (int quantum : job_quanta) {
+            SweepJob job;
+            job.config = base;
+            job.config.algorithm = algorithm;
+            job.config.quantum = quantum;
+            job.config.predict_bursts = base.predict_bursts && (algorithm == 3 || algorithm == 4);
+            std::string suffix = std::string("_") + algorithm_name(algorithm);
+            if (uses_quantum(algorithm)) {
+                suffix += "_q" + std::to_string(quantum);
+            }
+            std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](unsigned char c) { return std::tolower(c); });
+            job.output_file = output_file_with_suffix(output_file, suffix);
+            jobs.push_back(job);
         }
+    }
+    return jobs;
+}
 
-        if (current_io_process != nullptr && io_exec_flag) {
-            r_schedule.push_back(current_io_process->id);
-            current_io_process->bursts[current_io_process->current_burst]--;
+// Simulate and write every job, `threads` jobs at a time
+void run_sweep(const Workload& workload, std::vector<SweepJob>& jobs, unsigned threads, OutputFormat format, bool write_metrics_files) {
+    std::atomic<size_t> next_job(0);
+    auto worker = [&]() {
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+            SweepJob& job = jobs[i];
+            try {
+                auto start = std::chrono::steady_clock::now();
+                std::unique_ptr<GanttWriter> gantt;
+                if (job.config.record_gantt) {
+                    gantt.reset(new GanttWriter(job.output_file, format, job.config.cpus, job.config.resources, false, false, job.config.models_overhead()));
+                }
+                SimulationResult result = simulate(workload, job.config, gantt.get());
+                if (gantt) {
+                    gantt->finish();
+                }
+                job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                job.metrics = result.metrics;
+                if (write_metrics_files) {
+                    write_metrics_file(output_file_with_suffix(job.output_file, "_metrics"), result.metrics);
+                }
+            } catch (const std::exception& e) {
+                job.error = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < jobs.size(); t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+void write_sweep_summary(std::ostream& out, const std::vector<SweepJob>& jobs) {
+    out << std::left << std::setw(10) << "algorithm" << std::setw(9) << "quantum" << std::setw(12) << "makespan"
+        << std::setw(10) << "cpu_util" << std::setw(10) << "r_util" << std::setw(10) << "switches"
+        << std::setw(14) << "turnaround" << std::setw(14) << "waiting" << std::setw(14) << "response"
+        << std::setw(12) << "run_ms" << "output\n";
+    for (const auto& job : jobs) {
+        out << std::left << std::setw(10) << algorithm_name(job.config.algorithm)
+            << std::setw(9) << (uses_quantum(job.config.algorithm) ? std::to_string(job.config.quantum) : "-");
+        if (!job.error.empty()) {
+            out << "error: " << job.error << "\n";
+            continue;
+        }
+        double turnaround = 0, waiting = 0, response = 0;
+        for (const auto& process : job.metrics.processes) {
+            turnaround += process.turnaround();
+            waiting += process.waiting();
+            response += process.response();
+        }
+        double count = std::max<size_t>(1, job.metrics.processes.size());
+        out << std::setw(12) << job.metrics.makespan << std::fixed << std::setprecision(3)
+            << std::setw(10) << job.metrics.cpu_utilization() << std::setw(10) << job.metrics.r_utilization()
+            << std::setw(10) << job.metrics.context_switches
+            << std::setw(14) << turnaround / count << std::setw(14) << waiting / count << std::setw(14) << response / count
+            << std::setw(12) << job.seconds * 1000 << job.output_file << "\n";
+        out.unsetf(std::ios::fixed);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Benchmark: for each size a synthetic workload is generated and written to a scratch file,
+// then every algorithm is timed separately on parsing that file, simulating and writing the
+// Gantt chart.
+// ---------------------------------------------------------------------------------------------
+
+struct BenchmarkRun {
+    size_t processes = 0;
+    SimulationConfig config;
+    long long events = 0;
+    double parse_seconds = 0;
+    double simulate_seconds = 0;
+    double write_seconds = 0;
+};
+
+// Scheduling events of a finished run: arrivals, burst completions and context switches
+long long simulated_events(const Workload& workload, const Metrics& metrics) {
+    return static_cast<long long>(workload.size() + workload.bursts.size()) + metrics.context_switches;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<BenchmarkRun> run_benchmark(const std::string& scratch_file, const std::vector<size_t>& sizes, GeneratorConfig generator, const std::vector<SweepJob>& jobs, OutputFormat format) {
+    std::string gantt_file = output_file_with_suffix(scratch_file, "_gantt");
+    std::vector<BenchmarkRun> runs;
+    for (size_t size : sizes) {
+        generator.processes = size;
+        // Binary output goes with binary input, to time both ends of a binary pipeline
+        if (format == OutputFormat::Binary) {
+            write_binary_input_file(scratch_file, generate_workload(generator));
+        } else {
+            write_input_file(scratch_file, generate_workload(generator));
+        }
+
+        for (const auto& job : jobs) {
+            BenchmarkRun run;
+            run.processes = size;
+            run.config = job.config;
+
+            auto start = std::chrono::steady_clock::now();
+            Workload workload = read_input_file(scratch_file);
+            run.parse_seconds = seconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            SimulationResult result = simulate(workload, run.config);
+            run.simulate_seconds = seconds_since(start);
+            run.events = simulated_events(workload, result.metrics);
+
+            if (run.config.record_gantt) {
+                start = std::chrono::steady_clock::now();
+                write_output_file(gantt_file, result, format);
+                run.write_seconds = seconds_since(start);
+            }
+            runs.push_back(run);
+        }
+    }
+    std::remove(scratch_file.c_str());
+    std::remove(gantt_file.c_str());
+    return runs;
+}
+
+void write_benchmark_report(std::ostream& out, const std::vector<BenchmarkRun>& runs) {
+    out << std::left << std::setw(11) << "processes" << std::setw(10) << "algorithm" << std::setw(9) << "quantum"
+        << std::setw(13) << "events" << std::setw(12) << "parse_ms" << std::setw(13) << "simulate_ms"
+        << std::setw(12) << "write_ms" << "events_per_s\n";
+    for (const auto& run : runs) {
+        out << std::left << std::setw(11) << run.processes << std::setw(10) << algorithm_name(run.config.algorithm)
+            << std::setw(9) << (uses_quantum(run.config.algorithm) ? std::to_string(run.config.quantum) : "-")
+            << std::setw(13) << run.events << std::fixed << std::setprecision(3)
+            << std::setw(12) << run.parse_seconds * 1000 << std::setw(13) << run.simulate_seconds * 1000
+            << std::setw(12) << run.write_seconds * 1000 << std::setprecision(0)
+            << (run.simulate_seconds > 0 ? run.events / run.simulate_seconds : 0.0) << "\n";
+        out.unsetf(std::ios::fixed);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Verification: the tick engine is the reference for the event engine, whose output must match
+// it time unit for time unit. The golden input/output pairs of the repository are checked on
+// both engines, options only the event engine has on small fixed workloads, then random
+// workloads on the tick engine against the event engine (with the options given on the command
+// line). Every mismatch is reported by its first differing slot.
+// ---------------------------------------------------------------------------------------------
+
+// Input/output pairs with the algorithm and quantum that produced the output
+struct GoldenTest {
+    const char* input;
+    const char* output;
+    int algorithm;
+    int quantum;
+};
+
+const GoldenTest GOLDEN_TESTS[] = {
+    {"inp1.txt", "out1.txt", 1, 2},
+    {"inp2.txt", "out2.txt", 2, 3},
+    {"inp3.txt", "out3.txt", 2, 1},
+    {"inp4.txt", "out4.txt", 2, 3},
+};
+
+// Options of the event engine that the tick engine does not have, with the chart they must give
+struct EngineTest {
+    const char* name;
+    std::vector<std::vector<int>> processes;  // Arrival time, then the bursts
+    int algorithm;
+    int quantum;
+    std::vector<DeviceConfig> devices;
+    int dispatch_latency;
+    const char* cpu;  // Expected Gantt chart lines, expanded format
+    const char* r;
+    std::vector<int> weights = {};  // Empty = all 1
+};
+
+const DeviceConfig RR_DEVICE = {DevicePolicy::RoundRobin, 1};
+
+const EngineTest ENGINE_TESTS[] = {
+    // A round robin device without a positive quantum has no time slice
+    {"rr device, quantum 0", {{0, 2, 3, 1}, {0, 1, 3, 1}}, 1, 0, {RR_DEVICE}, 0, "1 1 2 _ _ 1 _ _ 2", "_ _ 1 1 1 2 2 2 _"},
+    {"rr device, quantum -1", {{0, 2, 3, 1}, {0, 1, 3, 1}}, 1, -1, {RR_DEVICE}, 0, "1 1 2 _ _ 1 _ _ 2", "_ _ 1 1 1 2 2 2 _"},
+    {"rr device, quantum 2", {{0, 2, 3, 1}, {0, 1, 3, 1}}, 1, 2, {RR_DEVICE}, 0, "1 1 2 _ _ _ _ 1 2", "_ _ 1 1 2 2 1 2 _"},
+    // Dispatch latency is paid when an instance takes a different process, not when the only
+    // queued process gets the instance back after its time slice
+    {"rr device, dispatch latency, one process", {{0, 1, 6, 1}}, 1, 2, {RR_DEVICE}, 1, "1 _ _ _ _ _ _ _ 1", "_ ~ 1 1 1 1 1 1 _"},
+    {"rr device, dispatch latency, two processes", {{0, 1, 4, 1}, {0, 1, 2, 1}}, 1, 2, {RR_DEVICE}, 1, "1 2 _ _ _ _ _ 2 _ _ 1", "_ ~ 1 1 ~ 2 2 ~ 1 1 _"},
+    // Aging counts whole slots: at time 10 P2 (1 + 10 / 10) and P3 (2 + 5 / 10) tie, the lower ID runs
+    {"priority, whole aging slots", {{0, 10}, {0, 1}, {5, 1}}, 6, 2, {}, 0, "1 1 1 1 1 1 1 1 1 1 2 3", "_ _ _ _ _ _ _ _ _ _ _ _", {1, 1, 2}},
+};
+
+// First time unit where two Gantt charts differ
+struct Divergence {
+    bool found = false;
+    std::string line;      // "CPU", "R", or with several "CPU 2", ...
+    long long time = 0;
+    int expected = 0;      // Process ID in the time unit (0 = idle, END_OF_CHART past the end)
+    int actual = 0;
+};
+
+const int END_OF_CHART = std::numeric_limits<int>::min();
+
+// Process on `timeline` in each time unit, walking forward from `index`
+struct TimelineCursor {
+    const Timeline& timeline;
+    size_t index = 0;
+
+    int id() const { return index < timeline.intervals.size() ? timeline.intervals[index].id : END_OF_CHART; }
+    long long end() const {
+        return index < timeline.intervals.size() ? timeline.intervals[index].start + timeline.intervals[index].length : std::numeric_limits<long long>::max();
+    }
+};
+
+Divergence first_divergence(const Timeline& expected, const Timeline& actual) {
+    Divergence divergence;
+    TimelineCursor a{expected};
+    TimelineCursor b{actual};
+    long long time = 0;
+    while (a.id() != END_OF_CHART || b.id() != END_OF_CHART) {
+        if (a.id() != b.id()) {
+            divergence.found = true;
+            divergence.time = time;
+            divergence.expected = a.id();
+            divergence.actual = b.id();
+            return divergence;
+        }
+        time = std::min(a.end(), b.end());
+        if (a.end() == time) {
+            a.index++;
+        }
+        if (b.end() == time) {
+            b.index++;
+        }
+    }
+    return divergence;
+}
 
-            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
-                current_io_process->current_burst++;
-                if (current_io_process->current_burst < current_io_process->bursts.size()) {
-                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
-                    new_processes.push_back(current_io_process);
-                } else {
-                    completed++;
-                }
-                
-                if (!io_queue.empty()) {
-                    current_io_process = io_queue.front();
-                    io_queue.pop();
-                } else {
-                    current_io_process = nullptr;
-                }
+Divergence first_divergence(const SimulationResult& expected, const SimulationResult& actual) {
+    Divergence first;
+    auto compare = [&](const std::vector<Timeline>& a, const std::vector<Timeline>& b, const std::string& name) {
+        if (a.size() != b.size()) {
+            throw std::runtime_error("The Gantt charts have a different number of " + name + " lines");
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            Divergence divergence = first_divergence(a[i], b[i]);
+            if (divergence.found && (!first.found || divergence.time < first.time)) {
+                first = divergence;
+                first.line = a.size() > 1 ? name + " " + std::to_string(i + 1) : name;
             }
-        } else {
-            r_schedule.push_back(0);
         }
+    };
+    compare(expected.cpu_schedules, actual.cpu_schedules, "CPU");
+    compare(expected.r_schedules, actual.r_schedules, "R");
+    return first;
+}
 
-        current_time++;
-        io_exec_flag = true;
+std::string describe_slot(int id) {
+    switch (id) {
+        case END_OF_CHART: return "end of chart";
+        case SWITCH_ID: return "context switch";
+        case DISPATCH_ID: return "dispatch";
+        case 0: return "idle";
+        default: return "P" + std::to_string(id);
     }
 }
 
-// Shortest Job First (SJF) scheduler
-void sjf_scheduler() {
-    std::vector<Process*> cpu_queue;
-    std::queue<Process*> io_queue;
+// e.g. "CPU differs at time 14: expected P3, event engine P5"
+std::string describe_divergence(const Divergence& divergence, const std::string& actual_name) {
+    return divergence.line + " differs at time " + std::to_string(divergence.time) + ": expected " + describe_slot(divergence.expected) + ", " +
+           actual_name + " " + describe_slot(divergence.actual);
+}
 
-    auto compare_sjf = [](Process* a, Process* b) {
-        if (a->bursts[a->current_burst] == b->bursts[b->current_burst]) {
-            // If burst times are equal, use the new priority system
-            if (a->arrival_time == current_time && b->arrival_time != current_time)
-                return false; // a has higher priority
-            if (b->arrival_time == current_time && a->arrival_time != current_time)
-                return true; // b has higher priority
-            if (a->just_from_io && !b->just_from_io)
-                return false; // a just moved from I/O, higher priority
-            if (b->just_from_io && !a->just_from_io)
-                return true; // b just moved from I/O, higher priority
-            return a->id > b->id; // If all else is equal, choose the process with lower ID
-        }
-        return a->bursts[a->current_burst] > b->bursts[b->current_burst];
-    };
+// Timeline of a Gantt chart line in the expanded text format
+Timeline parse_timeline(const std::string& line) {
+    Timeline timeline;
+    std::istringstream iss(line);
+    std::string token;
+    while (iss >> token) {
+        timeline.append(token == "_" ? 0 : token == "*" ? SWITCH_ID : token == "~" ? DISPATCH_ID : std::stoi(token));
+    }
+    return timeline;
+}
 
-    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
-        // Check for newly arrived processes
-        for (auto& process : processes) {
-            if (process.arrival_time == current_time && process.current_burst < process.bursts.size()) {
-                cpu_queue.push_back(&process);
-                std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
+std::string describe_config(const SimulationConfig& config) {
+    std::string name = algorithm_name(config.algorithm);
+    return uses_quantum(config.algorithm) ? name + " quantum " + std::to_string(config.quantum) : name;
+}
+
+// Run the golden tests in `golden_dir`, ENGINE_TESTS on the event engine, and `runs` random
+// workloads, each with up to `generator.processes` processes, for every algorithm (and quantum)
+// on both engines. The event engine runs with `candidate`. Returns the number of failures; the workload of the first
+// random failure is written to `failure_file`.
+int run_verification(const std::string& golden_dir, const std::vector<int>& algorithms, const std::vector<int>& quanta, GeneratorConfig generator, int runs, SimulationConfig candidate, const std::string& failure_file, std::ostream& out) {
+    if (candidate.cpus != 1 || candidate.resources != 1 || !candidate.devices.empty()) {
+        throw std::runtime_error("The engines can only be compared with one CPU and one R");
+    }
+    if (candidate.predict_bursts || candidate.models_overhead()) {
+        throw std::runtime_error("Burst prediction and switch or dispatch costs change the schedule, the engines cannot be compared with them");
+    }
+    candidate.tick_engine = false;
+    candidate.record_gantt = true;
+    SimulationConfig reference;
+    reference.tick_engine = true;
+
+    std::vector<std::pair<int, int>> configurations;
+    for (int algorithm : algorithms) {
+        if (algorithm < 1 || algorithm > 4) {
+            throw std::runtime_error("The tick engine only implements algorithms 1 to 4");
+        }
+        for (int quantum : quanta) {
+            configurations.emplace_back(algorithm, quantum);
+            if (!uses_quantum(algorithm)) {
+                break;
             }
         }
+    }
 
-        // Handle CPU scheduling
-        if (current_cpu_process == nullptr && !cpu_queue.empty()) {
-            std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
-            current_cpu_process = cpu_queue.back();
-            cpu_queue.pop_back();
-            current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
+    int golden_failures = 0;
+    for (const GoldenTest& test : GOLDEN_TESTS) {
+        std::string input = golden_dir + "/" + test.input;
+        std::string output = golden_dir + "/" + test.output;
+        Workload workload = read_input_file(input);
+        SimulationResult expected = read_output_file(output);
+        SimulationConfig engines[] = {reference, candidate};
+        for (SimulationConfig& config : engines) {
+            config.algorithm = test.algorithm;
+            config.quantum = test.quantum;
+            std::string engine = config.tick_engine ? "tick engine" : "event engine";
+            Divergence divergence = first_divergence(expected, simulate(workload, config));
+            out << "golden " << test.input << " " << describe_config(config) << " on the " << engine << ": ";
+            if (divergence.found) {
+                out << "FAILED, " << describe_divergence(divergence, engine) << std::endl;
+                golden_failures++;
+            } else {
+                out << "ok" << std::endl;
+            }
         }
+    }
 
-        if (current_cpu_process != nullptr) {
-            cpu_schedule.push_back(current_cpu_process->id);
-            current_cpu_process->bursts[current_cpu_process->current_burst]--;
-
-            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
-                current_cpu_process->current_burst++;
-                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
-                    if (current_io_process == nullptr) {
-                        io_exec_flag = false;
-                    }
-                    io_queue.push(current_cpu_process);
-                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
-                    if (current_io_process == nullptr) {
-                        current_io_process = io_queue.front();
-                        io_queue.pop();
-                    }
-                } else {
-                    completed++;
-                }
-                current_cpu_process = nullptr;
-            }
+    for (const EngineTest& test : ENGINE_TESTS) {
+        Workload workload;
+        for (const auto& process : test.processes) {
+            workload.bursts.insert(workload.bursts.end(), process.begin() + 1, process.end());
+            workload.close_process(process[0]);
+        }
+        SimulationConfig config = candidate;
+        config.algorithm = test.algorithm;
+        config.quantum = test.quantum;
+        config.devices = test.devices;
+        config.dispatch_latency = test.dispatch_latency;
+        config.aging = SimulationConfig().aging;  // The tests are written for the default
+        workload.weights = test.weights;
+        SimulationResult expected;
+        expected.cpu_schedules.push_back(parse_timeline(test.cpu));
+        expected.r_schedules.push_back(parse_timeline(test.r));
+        Divergence divergence = first_divergence(expected, simulate(workload, config));
+        out << "event engine " << test.name << ": ";
+        if (divergence.found) {
+            out << "FAILED, " << describe_divergence(divergence, "event engine") << std::endl;
+            golden_failures++;
         } else {
-            cpu_schedule.push_back(0);
+            out << "ok" << std::endl;
         }
+    }
 
-        // Handle I/O scheduling (FCFS)
-        if (current_io_process == nullptr && !io_queue.empty()) {
-            current_io_process = io_queue.front();
-            io_queue.pop();
+    // Random sizes from 1 process up, so that small corner cases come up often
+    size_t max_processes = std::max<size_t>(generator.processes, 1);
+    uint64_t first_seed = generator.seed;
+    int failures = 0;
+    for (int run = 0; run < runs; run++) {
+        generator.seed = first_seed + run;
+        generator.processes = 1 + std::mt19937_64(generator.seed)() % max_processes;
+        Workload workload = generate_workload(generator);
+        for (const auto& configuration : configurations) {
+            reference.algorithm = candidate.algorithm = configuration.first;
+            reference.quantum = candidate.quantum = configuration.second;
+            Divergence divergence = first_divergence(simulate(workload, reference), simulate(workload, candidate));
+            if (!divergence.found) {
+                continue;
+            }
+            failures++;
+            out << "seed " << generator.seed << " (" << workload.size() << " processes) " << describe_config(reference) << ": FAILED, "
+                << describe_divergence(divergence, "event engine");
+            if (failures == 1) {
+                write_input_file(failure_file, workload);
+                out << ", workload written to " << failure_file;
+            }
+            out << std::endl;
         }
+    }
+    out << runs << " random workloads (seeds " << first_seed << " to " << first_seed + runs - 1 << ") with " << configurations.size()
+        << " configurations: " << (failures == 0 ? "ok" : std::to_string(failures) + " failures") << std::endl;
+    return golden_failures + failures;
+}
 
-        if (current_io_process != nullptr && io_exec_flag) {
-            r_schedule.push_back(current_io_process->id);
-            current_io_process->bursts[current_io_process->current_burst]--;
+// Parse a comma-separated list of integers such as "1,2,4"
+std::vector<int> parse_int_list(const std::string& text) {
+    std::vector<int> values;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        values.push_back(std::stoi(item));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("Empty list: " + text);
+    }
+    return values;
+}
 
-            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
-                current_io_process->current_burst++;
-                if (current_io_process->current_burst < current_io_process->bursts.size()) {
-                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
-                    cpu_queue.push_back(current_io_process);
-                    std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_sjf);
-                } else {
-                    completed++;
-                }
-                
-                if (!io_queue.empty()) {
-                    current_io_process = io_queue.front();
-                    io_queue.pop();
-                } else {
-                    current_io_process = nullptr;
-                }
-            }
+// Parse device classes written as a comma-separated list of `<policy>[:<instances>]`, where the
+// policy is fcfs, sstf or rr, e.g. "fcfs:2,sstf,rr"
+std::vector<DeviceConfig> parse_devices(const std::string& text) {
+    std::vector<DeviceConfig> devices;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        size_t colon = item.find(':');
+        std::string policy = item.substr(0, colon);
+        DeviceConfig device;
+        if (policy == "fcfs") {
+            device.policy = DevicePolicy::Fcfs;
+        } else if (policy == "sstf") {
+            device.policy = DevicePolicy::Sstf;
+        } else if (policy == "rr") {
+            device.policy = DevicePolicy::RoundRobin;
         } else {
-            r_schedule.push_back(0);
+            throw std::invalid_argument("Unknown device policy: " + policy);
         }
+        if (colon != std::string::npos) {
+            device.instances = std::stoi(item.substr(colon + 1));
+        }
+        devices.push_back(device);
+    }
+    if (devices.empty() || devices.size() > static_cast<size_t>(MAX_DEVICES)) {
+        throw std::invalid_argument("Expected 1 to " + std::to_string(MAX_DEVICES) + " device classes, got " + text);
+    }
+    return devices;
+}
 
-        current_time++;
-        io_exec_flag = true;
+// If `arg` is `--<name>=<value>`, store the value and return true
+bool option_value(const std::string& arg, const std::string& name, std::string& value) {
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
     }
+    value = arg.substr(prefix.size());
+    return true;
 }
 
-// Shortest Remaining Time Next (SRTN) scheduler
-void srtn_scheduler() {
-    std::vector<Process*> cpu_queue;
-    std::queue<Process*> io_queue;
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <input_file> <output_file> <algorithm> [quantum] [--engine=event|tick] [--format=expanded|intervals|binary] [--metrics] [--no-gantt] [--verbose] [--cpus=N] [--resources=N] [--devices=POLICY[:N],...] [--switch-cost=T] [--dispatch-latency=T] [--per-core-queues] [--stream] [--weights=FILE] [--levels=N] [--boost=N] [--aging=N] [--seed=N] [--predict] [--alpha=A] [--initial-estimate=T] [--ready-heap=binary|packed] [--checkpoint=FILE] [--checkpoint-interval=SECONDS] [--profile=FILE]\n"
+              << "       " << program << " --sweep <input_file> <output_file> [--algorithms=1,2,3,4] [--quanta=2] [--threads=N] [--engine=event|tick] [--format=expanded|intervals|binary] [--metrics] [--no-gantt] [--verbose] [--cpus=N] [--resources=N] [--devices=POLICY[:N],...] [--switch-cost=T] [--dispatch-latency=T] [--per-core-queues] [--predict] [--alpha=A] [--initial-estimate=T] [--ready-heap=binary|packed]\n"
+              << "       " << program << " --generate <output_file> [--format=binary] [--processes=N] [--seed=N] [--arrivals=<kind>:<mean>] [--cpu-bursts=<kind>:<mean>] [--r-bursts=<kind>:<mean>] [--pairs=MIN[-MAX]]\n"
+              << "       " << program << " --convert-workload <input_file> <output_file>\n"
+              << "       " << program << " --convert-gantt <input_file> <output_file> [--cpus=N] [--format=expanded|intervals]\n"
+              << "       " << program << " --benchmark <scratch_file> [--sizes=10,1000,100000,1000000] [--algorithms=1,2,3,4] [--quanta=2] [generator options] [simulation options]\n"
+              << "       " << program << " --verify [<golden_dir>] [--runs=1000] [--seed=N] [--processes=12] [--algorithms=1,2,3,4] [--quanta=2] [generator options] [event engine options]\n";
+}
 
-    auto compare_srtn = [](Process* a, Process* b) {
-        if (a->remaining_time == b->remaining_time) {
-            if (a->arrival_time == current_time && b->arrival_time != current_time)
-                return false; // a has higher priority
-            if (b->arrival_time == current_time && a->arrival_time != current_time)
-                return true; // b has higher priority
-            if (a->just_from_io && !b->just_from_io)
-                return false; // a just moved from I/O, higher priority
-            if (b->just_from_io && !a->just_from_io)
-                return true; // b just moved from I/O, higher priority
-            return a->id > b->id; // If all else is equal, choose the process with lower ID
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    SimulationConfig config;
+    OutputFormat format = OutputFormat::Expanded;
+    bool sweep = false;
+    bool stream = false;
+    std::string weights_file;
+    bool generate = false;
+    bool benchmark = false;
+    bool convert_workload = false;
+    bool convert_gantt = false;
+    bool verify = false;
+    int verify_runs = 1000;
+    GeneratorConfig generator;
+    bool processes_given = false;
+    std::vector<int> benchmark_sizes = {10, 1000, 100000, 1000000};
+    bool metrics = false;
+    bool verbose = false;
+    std::string profile_file;
+    bool resources_given = false;
+    std::vector<int> sweep_algorithms = {1, 2, 3, 4};
+    std::vector<int> sweep_quanta = {config.quantum};
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+        if (arg == "--engine=tick") {
+            config.tick_engine = true;
+        } else if (arg == "--engine=event") {
+            config.tick_engine = false;
+        } else if (arg == "--format=expanded") {
+            format = OutputFormat::Expanded;
+        } else if (arg == "--format=intervals") {
+            format = OutputFormat::Intervals;
+        } else if (arg == "--format=binary") {
+            format = OutputFormat::Binary;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--metrics") {
+            metrics = true;
+        } else if (arg == "--no-gantt") {
+            config.record_gantt = false;
+        } else if (arg == "--sweep") {
+            sweep = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--generate") {
+            generate = true;
+        } else if (arg == "--benchmark") {
+            benchmark = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (option_value(arg, "runs", value)) {
+            verify_runs = std::stoi(value);
+        } else if (arg == "--convert-workload") {
+            convert_workload = true;
+        } else if (arg == "--convert-gantt") {
+            convert_gantt = true;
+        } else if (option_value(arg, "sizes", value)) {
+            benchmark_sizes = parse_int_list(value);
+        } else if (option_value(arg, "processes", value)) {
+            generator.processes = std::stoul(value);
+            processes_given = true;
+        } else if (option_value(arg, "seed", value)) {
+            generator.seed = std::stoull(value);
+            config.seed = generator.seed;
+        } else if (option_value(arg, "weights", value)) {
+            weights_file = value;
+        } else if (option_value(arg, "levels", value)) {
+            config.mlfq_levels = std::stoi(value);
+        } else if (option_value(arg, "boost", value)) {
+            config.mlfq_boost = std::stoll(value);
+        } else if (option_value(arg, "aging", value)) {
+            config.aging = std::stoi(value);
+        } else if (arg == "--predict") {
+            config.predict_bursts = true;
+        } else if (option_value(arg, "alpha", value)) {
+            config.alpha = std::stod(value);
+            config.predict_bursts = true;
+        } else if (option_value(arg, "initial-estimate", value)) {
+            config.initial_estimate = std::stod(value);
+            config.predict_bursts = true;
+        } else if (option_value(arg, "checkpoint", value)) {
+            config.checkpoint_file = value;
+        } else if (option_value(arg, "checkpoint-interval", value)) {
+            config.checkpoint_interval = std::stod(value);
+        } else if (option_value(arg, "profile", value)) {
+            profile_file = value;
+        } else if (arg == "--ready-heap=binary") {
+            config.packed_heap = false;
+        } else if (arg == "--ready-heap=packed") {
+            config.packed_heap = true;
+        } else if (option_value(arg, "arrivals", value)) {
+            generator.arrival_gap = parse_distribution(value);
+        } else if (option_value(arg, "cpu-bursts", value)) {
+            generator.cpu_burst = parse_distribution(value);
+        } else if (option_value(arg, "r-bursts", value)) {
+            generator.r_burst = parse_distribution(value);
+        } else if (option_value(arg, "pairs", value)) {
+            size_t dash = value.find('-');
+            generator.min_pairs = std::stoi(value.substr(0, dash));
+            generator.max_pairs = dash == std::string::npos ? generator.min_pairs : std::stoi(value.substr(dash + 1));
+        } else if (option_value(arg, "algorithms", value)) {
+            sweep_algorithms = parse_int_list(value);
+        } else if (option_value(arg, "quanta", value)) {
+            sweep_quanta = parse_int_list(value);
+        } else if (option_value(arg, "cpus", value)) {
+            config.cpus = std::stoi(value);
+        } else if (option_value(arg, "resources", value)) {
+            config.resources = std::stoi(value);
+            resources_given = true;
+        } else if (option_value(arg, "devices", value)) {
+            config.devices = parse_devices(value);
+        } else if (option_value(arg, "switch-cost", value)) {
+            config.switch_cost = std::stoi(value);
+        } else if (option_value(arg, "dispatch-latency", value)) {
+            config.dispatch_latency = std::stoi(value);
+        } else if (arg == "--per-core-queues") {
+            config.per_core_queues = true;
+        } else if (option_value(arg, "threads", value)) {
+            threads = static_cast<unsigned>(std::max(1, std::stoi(value)));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            args.push_back(arg);
         }
-        return a->remaining_time > b->remaining_time; // Shorter remaining time has higher priority
-    };
-
-    // Initialize remaining time for all processes
-    for (auto& process : processes) {
-        process.remaining_time = process.bursts[0];
     }
 
-    while (completed < processes.size() || !cpu_queue.empty() || !io_queue.empty() || current_cpu_process != nullptr || current_io_process != nullptr) {
-        // Check for newly arrived processes
-        for (auto& process : processes) {
-            if (process.arrival_time == current_time && process.current_burst < process.bursts.size()) {
-                cpu_queue.push_back(&process);
-                std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
-            }
+    if (!config.devices.empty()) {
+        if (resources_given) {
+            std::cerr << "--devices gives the number of instances of every device class, it cannot be combined with --resources\n";
+            return 1;
         }
+        config.resources = 0;
+        for (const auto& device : config.devices) {
+            config.resources += device.instances;
+        }
+    }
 
-        // Handle CPU scheduling
-        if (!cpu_queue.empty()) {
-            Process* shortest_process = cpu_queue.front(); // The shortest process is at the front of the heap
-            
-            if (current_cpu_process == nullptr) {
-                std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
-                current_cpu_process = cpu_queue.back();
-                cpu_queue.pop_back();
-                current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
-            } else if (shortest_process->remaining_time < current_cpu_process->remaining_time) {
-                cpu_queue.push_back(current_cpu_process);
-                std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
-                std::pop_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
-                current_cpu_process = cpu_queue.back();
-                cpu_queue.pop_back();
-                current_cpu_process->just_from_io = false;  // Reset the flag when process starts CPU burst
+    if (!config.checkpoint_file.empty() && (generate || benchmark || sweep || stream || convert_workload || convert_gantt || verify)) {
+        std::cerr << "--checkpoint only applies to a single simulation with the input in memory\n";
+        return 1;
+    }
+#ifdef SCHEDULER_PROFILE
+    if (!profile_file.empty() && (generate || benchmark || sweep || stream || convert_workload || convert_gantt || verify)) {
+        std::cerr << "--profile only applies to a single simulation with the input in memory\n";
+        return 1;
+    }
+#else
+    if (!profile_file.empty()) {
+        std::cerr << "--profile needs a build with -DSCHEDULER_PROFILE\n";
+        return 1;
+    }
+#endif
+
+    if (verify) {
+        if (args.size() > 1 || generate || benchmark || sweep || stream || convert_workload || convert_gantt) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        try {
+            // Small workloads unless asked otherwise: a divergence is easiest to follow in those
+            if (!processes_given) {
+                generator.processes = 12;
             }
+            std::string golden_dir = args.empty() ? "." : args[0];
+            int failures = run_verification(golden_dir, sweep_algorithms, sweep_quanta, generator, verify_runs, config, "verify_failure.txt", std::cout);
+            return failures == 0 ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
         }
+    }
 
-        if (current_cpu_process != nullptr) {
-            cpu_schedule.push_back(current_cpu_process->id);
-            current_cpu_process->bursts[current_cpu_process->current_burst]--;
-            current_cpu_process->remaining_time--;
-
-            if (current_cpu_process->bursts[current_cpu_process->current_burst] == 0) {
-                current_cpu_process->current_burst++;
-                if (current_cpu_process->current_burst < current_cpu_process->bursts.size()) {
-                    if (current_io_process == nullptr) {
-                        io_exec_flag = false;
-                    }
-                    io_queue.push(current_cpu_process);
-                    // Push the first process to the I/O ready queue, but this process starts after 1 unit of time
-                    if (current_io_process == nullptr) {
-                        current_io_process = io_queue.front();
-                        io_queue.pop();
-                    }
-                    current_cpu_process->remaining_time = current_cpu_process->bursts[current_cpu_process->current_burst];
+    if (generate || benchmark) {
+        if (args.size() != 1 || (generate && benchmark)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        try {
+            if (generate) {
+                if (format == OutputFormat::Binary) {
+                    write_binary_input_file(args[0], generate_workload(generator));
                 } else {
-                    completed++;
+                    write_input_file(args[0], generate_workload(generator));
                 }
-                current_cpu_process = nullptr;
+                std::cout << "Wrote " << generator.processes << " processes to " << args[0] << std::endl;
+                return 0;
             }
-        } else {
-            cpu_schedule.push_back(0);
+            std::vector<size_t> sizes(benchmark_sizes.begin(), benchmark_sizes.end());
+            std::vector<SweepJob> jobs = make_sweep_jobs(args[0], sweep_algorithms, sweep_quanta, config);
+            std::vector<BenchmarkRun> runs = run_benchmark(args[0], sizes, generator, jobs, format);
+            write_benchmark_report(std::cout, runs);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
         }
+        return 0;
+    }
 
-        // Handle I/O scheduling (FCFS)
-        if (current_io_process == nullptr && !io_queue.empty()) {
-            current_io_process = io_queue.front();
-            io_queue.pop();
+    if (convert_workload || convert_gantt) {
+        if (args.size() != 2 || (convert_workload && convert_gantt)) {
+            print_usage(argv[0]);
+            return 1;
         }
-
-        if (current_io_process != nullptr && io_exec_flag) {
-            r_schedule.push_back(current_io_process->id);
-            current_io_process->bursts[current_io_process->current_burst]--;
-
-            if (current_io_process->bursts[current_io_process->current_burst] == 0) {
-                current_io_process->current_burst++;
-                if (current_io_process->current_burst < current_io_process->bursts.size()) {
-                    current_io_process->remaining_time = current_io_process->bursts[current_io_process->current_burst];
-                    current_io_process->just_from_io = true;  // Set the flag when process finishes I/O burst
-                    cpu_queue.push_back(current_io_process);
-                    std::push_heap(cpu_queue.begin(), cpu_queue.end(), compare_srtn);
-                } else {
-                    completed++;
-                }
-                
-                if (!io_queue.empty()) {
-                    current_io_process = io_queue.front();
-                    io_queue.pop();
+        // Binary files are converted to text and text files to binary
+        try {
+            MappedFile input(args[0]);
+            bool binary = has_magic(input.data, input.size, convert_workload ? WORKLOAD_MAGIC : GANTT_MAGIC);
+            if (convert_workload) {
+                Workload workload = read_input_file(args[0]);
+                if (binary) {
+                    write_input_file(args[1], workload);
                 } else {
-                    current_io_process = nullptr;
+                    write_binary_input_file(args[1], workload);
                 }
+            } else {
+                SimulationResult result = read_output_file(args[0], config.cpus);
+                OutputFormat text_format = format == OutputFormat::Binary ? OutputFormat::Expanded : format;
+                write_output_file(args[1], result, binary ? text_format : OutputFormat::Binary);
             }
-        } else {
-            r_schedule.push_back(0);
+            std::cout << "Converted " << args[0] << " to " << (binary ? "text" : "binary") << " in " << args[1] << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
         }
-
-        current_time++;
-        io_exec_flag = true;
+        return 0;
     }
-}
 
-int main(int argc, char* argv[]) {
-    if (argc < 4 || argc >= 6) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> <algorithm> [quantum]\n";
+    if (sweep ? args.size() != 2 : (args.size() < 3 || args.size() > 4)) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    std::string input_file = argv[1];
-    std::string output_file = argv[2];
-    int algorithm = std::stoi(argv[3]);
-    int quantum = (argc == 5) ? std::stoi(argv[4]) : 2;
+    std::string input_file = args[0];
+    std::string output_file = args[1];
+    if (!sweep) {
+        config.algorithm = std::stoi(args[2]);
+        if (args.size() == 4) {
+            config.quantum = std::stoi(args[3]);
+        }
+    }
+
+    if (stream) {
+        if (sweep || metrics || !weights_file.empty()) {
+            std::cerr << "--stream cannot be combined with --sweep, --metrics or --weights\n";
+            return 1;
+        }
+        std::FILE* input = input_file == "-" ? stdin : std::fopen(input_file.c_str(), "rb");
+        if (input == nullptr) {
+            std::cerr << "Error: Error opening input file: " << input_file << std::endl;
+            return 1;
+        }
+        try {
+            std::unique_ptr<GanttWriter> gantt;
+            if (config.record_gantt) {
+                gantt.reset(new GanttWriter(output_file, format, config.cpus, config.resources, false, false, config.models_overhead()));
+            }
+            SimulationResult result = simulate_stream(input, config, gantt.get());
+            if (input != stdin) {
+                std::fclose(input);
+            }
+
+            std::cout << "Finished scheduling" << std::endl;
+            write_prediction_summary(std::cout, result.metrics);
+            write_device_summary(std::cout, result.metrics);
+
+            if (gantt) {
+                gantt->finish();
+                std::cout << "Wrote output file successfully" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
     try {
-        read_input_file(input_file);
+        PROFILE(PhaseTimes phases; auto phase_start = std::chrono::steady_clock::now());
+        Workload workload = read_input_file(input_file, verbose);
+        if (!weights_file.empty()) {
+            read_weights_file(weights_file, workload);
+        }
 
         std::cout << "Read input file successfully" << std::endl;
+        PROFILE(auto now = std::chrono::steady_clock::now(); phases.parse = std::chrono::duration<double>(now - phase_start).count(); phase_start = now);
 
-        switch (algorithm) {
-            case 1:
-                fcfs_scheduler();
-                break;
-            case 2:
-                rr_scheduler(quantum);
-                break;
-            case 3:
-                sjf_scheduler();
-                break;
-            case 4:
-                srtn_scheduler();
-                break;
-            default:
-                throw std::runtime_error("Invalid algorithm specified");
+        if (sweep) {
+            std::vector<SweepJob> jobs = make_sweep_jobs(output_file, sweep_algorithms, sweep_quanta, config);
+            run_sweep(workload, jobs, threads, format, metrics);
+
+            std::cout << "Finished sweep of " << jobs.size() << " configurations" << std::endl;
+
+            std::string summary_file = output_file_with_suffix(output_file, "_summary");
+            std::ofstream summary(summary_file);
+            if (!summary.is_open()) {
+                throw std::runtime_error("Error opening summary file");
+            }
+            write_sweep_summary(summary, jobs);
+            write_sweep_summary(std::cout, jobs);
+
+            bool failed = std::any_of(jobs.begin(), jobs.end(), [](const SweepJob& job) { return !job.error.empty(); });
+            return failed ? 1 : 0;
+        }
+
+        // A run with a checkpoint file continues from it if it exists
+        bool checkpoints = !config.checkpoint_file.empty();
+        config.resume = checkpoints && std::ifstream(config.checkpoint_file).good();
+        if (config.resume) {
+            std::cout << "Resuming from " << config.checkpoint_file << std::endl;
+        }
+
+        // The Gantt chart is written while the simulation runs
+        std::unique_ptr<GanttWriter> gantt;
+        if (config.record_gantt) {
+            gantt.reset(new GanttWriter(output_file, format, config.cpus, config.resources, checkpoints, config.resume, config.models_overhead()));
         }
 
+        SimulationResult result = simulate(workload, config, gantt.get());
+        // The Gantt chart is written during the simulation, that time goes to the write phase
+        PROFILE(now = std::chrono::steady_clock::now(); phases.simulate = std::chrono::duration<double>(now - phase_start).count(); phase_start = now);
+        PROFILE(phases.write = gantt ? gantt->write_seconds() : 0; phases.simulate -= phases.write);
+
         std::cout << "Finished scheduling" << std::endl;
+        write_prediction_summary(std::cout, result.metrics);
+        write_device_summary(std::cout, result.metrics);
+
+        if (gantt) {
+            gantt->finish();
+            std::cout << "Wrote output file successfully" << std::endl;
+        }
+        if (checkpoints) {
+            std::remove(config.checkpoint_file.c_str());
+        }
 
-        write_output_file(output_file);
+        if (metrics) {
+            write_metrics_file(output_file_with_suffix(output_file, "_metrics"), result.metrics);
+            std::cout << "Wrote metrics file successfully" << std::endl;
+        }
 
-        std::cout << "Wrote output file successfully" << std::endl;
+#ifdef SCHEDULER_PROFILE
+        if (!profile_file.empty()) {
+            phases.write += std::chrono::duration<double>(std::chrono::steady_clock::now() - phase_start).count();
+            write_profile_file(profile_file, config, workload.size(), phases, result);
+            std::cout << "Wrote profile file successfully" << std::endl;
+        }
+#endif
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}